@@ -0,0 +1,303 @@
+/**
+ * allocator.hxx file
+ * @author: Eros Fabrici
+ * @author: Dogan Can Demirbilek
+ * @author: Alessandro Scardoni
+ **/
+
+#ifndef ALLOCATOR_HXX__
+#define ALLOCATOR_HXX__
+
+#include <new>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+/**
+ * Node allocators for bst. A node allocator hands out uninitialized memory
+ * for a single node at a time (allocate/deallocate). release() gives back
+ * at once the memory of every node allocated so far: it is called by the
+ * tree only after all the nodes have been destroyed, and it is worth
+ * calling instead of deallocating one node at a time only when
+ * bulk_release is true.
+ * Nodes can also leave their tree (see bst::extract): share() returns an
+ * allocator that keeps the memory of the nodes allocated so far valid for
+ * as long as it exists, and can deallocate them but must not allocate.
+ * shares(other) tells whether the nodes allocated by other can be
+ * deallocated by this allocator, i.e. whether a node can move to its tree
+ * without being allocated again.
+ */
+
+/**
+ * @brief Allocator that gets every node from the global operator new,
+ * as std::make_unique would do.
+ */
+template<class T>
+class heap_allocator
+{
+    public:
+        static constexpr bool bulk_release = false;
+
+        /**
+         * @brief Allocates the memory for one node
+         * @return Pointer to uninitialized memory suitable for a T
+         */
+        T* allocate()
+        {
+            return static_cast<T*>(::operator new(sizeof(T)));
+        }
+
+        /**
+         * @brief Frees the memory of one node
+         * @param ptr Pointer returned by allocate()
+         */
+        void deallocate(T* ptr) noexcept
+        {
+            ::operator delete(ptr);
+        }
+
+        /**
+         * @brief Nothing to do, every node has already been deallocated
+         */
+        void release() noexcept {}
+
+        /**
+         * @brief Every node is valid until it is deallocated, whatever the
+         * allocator that allocated it
+         * @return Another heap_allocator
+         */
+        heap_allocator share() const noexcept { return heap_allocator{}; }
+
+        /**
+         * @brief Any node can be deallocated by any heap_allocator
+         * @return true
+         */
+        bool shares(const heap_allocator&) const noexcept { return true; }
+};
+
+/**
+ * @brief Slab allocator: nodes are carved out of big contiguous blocks of
+ * memory (slabs) whose size doubles every time a new one is needed, so
+ * that nodes allocated one after the other end up next to each other.
+ * Deallocated nodes are kept in a free list and reused by the next
+ * allocations, while release() frees all the slabs at once.
+ * The slabs are owned by a reference-counted group, which only this pool
+ * adds slabs to: the pools returned by share() just keep it alive, so that
+ * the node held by a node handle outlives the tree it was extracted from.
+ * The pools of two different trees never share a group.
+ */
+template<class T>
+class pool_allocator
+{
+    private:
+        /**
+         * an unused slot stores the pointer to the next unused one
+         */
+        struct free_slot
+        {
+            free_slot *next;
+        };
+
+        /**
+         * number of slots in the first slab and maximum number of
+         * slots in a slab
+         */
+        static constexpr std::size_t first_slab = 64;
+        static constexpr std::size_t max_slab = 1 << 16;
+
+        /**
+         * @brief Owner of the slabs of a pool, freed when the pool and all
+         * the pools returned by its share() have released it
+         */
+        struct slab_group
+        {
+            std::vector<void*> slabs;
+
+            slab_group() = default;
+            slab_group(const slab_group&) = delete;
+            slab_group& operator=(const slab_group&) = delete;
+
+            ~slab_group()
+            {
+                for (void *slab : slabs)
+                {
+                    ::operator delete(slab, std::align_val_t{alignment()});
+                }
+            }
+        };
+
+        /**
+         * group owning the slabs this pool has obtained, null until the
+         * first one is needed
+         */
+        std::shared_ptr<slab_group> group;
+        /**
+         * first unused byte of the last slab and end of the last slab
+         */
+        unsigned char *cursor{nullptr}, *slab_end{nullptr};
+        /**
+         * list of the slots that have been deallocated
+         */
+        free_slot *free_list{nullptr};
+        /**
+         * number of slots of the next slab
+         */
+        std::size_t next_slab{first_slab};
+
+        static constexpr std::size_t alignment() noexcept
+        {
+            return std::max(alignof(T), alignof(free_slot));
+        }
+
+        static constexpr std::size_t slot_size() noexcept
+        {
+            std::size_t size = std::max(sizeof(T), sizeof(free_slot));
+            return (size + alignment() - 1) / alignment() * alignment();
+        }
+
+        /**
+         * @brief Allocates a new slab, which becomes the one nodes are taken from
+         */
+        void grow()
+        {
+            if (!group)
+            {
+                group = std::make_shared<slab_group>();
+            }
+            void *slab = ::operator new(next_slab * slot_size(), std::align_val_t{alignment()});
+            try
+            {
+                group->slabs.push_back(slab);
+            }
+            catch (...)
+            {
+                ::operator delete(slab, std::align_val_t{alignment()});
+                throw;
+            }
+            cursor = static_cast<unsigned char*>(slab);
+            slab_end = cursor + next_slab * slot_size();
+            next_slab = std::min(next_slab * 2, max_slab);
+        }
+
+    public:
+        static constexpr bool bulk_release = true;
+
+        pool_allocator() noexcept = default;
+
+        // every tree owns its own pool
+        pool_allocator(const pool_allocator&) = delete;
+        pool_allocator& operator=(const pool_allocator&) = delete;
+
+        /**
+         * @brief Move constructor: the slabs are stolen from other,
+         * which is left empty
+         * @param other The pool to be moved
+         */
+        pool_allocator(pool_allocator&& other) noexcept :
+            group{std::move(other.group)},
+            cursor{std::exchange(other.cursor, nullptr)},
+            slab_end{std::exchange(other.slab_end, nullptr)},
+            free_list{std::exchange(other.free_list, nullptr)},
+            next_slab{std::exchange(other.next_slab, first_slab)}
+        {}
+
+        /**
+         * @brief Move assignment: the slabs of this pool are released and
+         * the ones of other are stolen
+         * @param other The pool to be moved
+         */
+        pool_allocator& operator=(pool_allocator&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                group = std::move(other.group);
+                cursor = std::exchange(other.cursor, nullptr);
+                slab_end = std::exchange(other.slab_end, nullptr);
+                free_list = std::exchange(other.free_list, nullptr);
+                next_slab = std::exchange(other.next_slab, first_slab);
+            }
+            return *this;
+        }
+
+        ~pool_allocator()
+        {
+            release();
+        }
+
+        /**
+         * @brief Allocates the memory for one node, reusing a deallocated
+         * slot if there is one
+         * @return Pointer to uninitialized memory suitable for a T
+         */
+        T* allocate()
+        {
+            if (free_list)
+            {
+                free_slot *slot = free_list;
+                free_list = slot->next;
+                return reinterpret_cast<T*>(slot);
+            }
+
+            if (cursor == slab_end)
+            {
+                grow();
+            }
+            T *ptr = reinterpret_cast<T*>(cursor);
+            cursor += slot_size();
+            return ptr;
+        }
+
+        /**
+         * @brief Gives back the memory of one node, which will be reused
+         * by the next allocation
+         * @param ptr Pointer returned by allocate()
+         */
+        void deallocate(T* ptr) noexcept
+        {
+            free_slot *slot = reinterpret_cast<free_slot*>(ptr);
+            slot->next = free_list;
+            free_list = slot;
+        }
+
+        /**
+         * @brief Frees all the slabs at once, or leaves them to the node
+         * handles still holding one of their nodes. Every node of the tree
+         * must have already been destroyed.
+         */
+        void release() noexcept
+        {
+            group.reset();
+            cursor = slab_end = nullptr;
+            free_list = nullptr;
+            next_slab = first_slab;
+        }
+
+        /**
+         * @brief Returns a pool keeping the slabs of this one alive, which
+         * can deallocate the nodes allocated so far but must not allocate
+         * @return A pool with no free slot of its own
+         */
+        pool_allocator share() const noexcept
+        {
+            pool_allocator shared;
+            shared.group = group;
+            return shared;
+        }
+
+        /**
+         * @brief Tells whether the nodes allocated by other lie in the slabs
+         * of this pool, which happens when other was returned by share()
+         * and this pool has not been released since
+         * @param other Another pool
+         * @return True if this pool can deallocate the nodes of other
+         */
+        bool shares(const pool_allocator& other) const noexcept
+        {
+            return group && group == other.group;
+        }
+};
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * balance.hxx file
+ * @author: Eros Fabrici
+ * @author: Dogan Can Demirbilek
+ * @author: Alessandro Scardoni
+ **/
+
+#ifndef BALANCE_HXX__
+#define BALANCE_HXX__
+
+#include <cstddef>
+
+/**
+ * Balancing policies for bst. A policy provides the extra bookkeeping
+ * stored in every node (node_base, which Node inherits from) and tells
+ * the tree whether it has to restore the balance after each insertion
+ * or removal, and whether every node also stores the size of its
+ * sub-tree (needed by rank, select and count_range).
+ */
+
+/**
+ * @brief Policy that never rebalances on its own: the tree keeps the shape
+ * given by the insertion order until balance() is called.
+ */
+struct no_balance
+{
+    static constexpr bool self_balancing = false;
+    static constexpr bool subtree_size = false;
+
+    struct node_base {};
+};
+
+/**
+ * @brief AVL policy: every node stores the height of its sub-tree and
+ * after each insert/erase the tree is rotated so that the heights of the
+ * two children of any node differ by at most one.
+ */
+struct avl_balance
+{
+    static constexpr bool self_balancing = true;
+    static constexpr bool subtree_size = false;
+
+    struct node_base
+    {
+        /**
+         * height of the sub-tree rooted in the node (a leaf has height 1)
+         */
+        int height{1};
+    };
+};
+
+/**
+ * @brief Augments another policy: every node also stores the number of
+ * nodes of its sub-tree, kept up to date by insertions, removals and
+ * rotations. It makes size() constant time and rank, select and
+ * count_range proportional to the height of the tree.
+ */
+template<class Policy = no_balance>
+struct order_statistics
+{
+    static constexpr bool self_balancing = Policy::self_balancing;
+    static constexpr bool subtree_size = true;
+
+    struct node_base : Policy::node_base
+    {
+        /**
+         * number of nodes of the sub-tree rooted in the node
+         */
+        std::size_t size{1};
+    };
+};
+
+#endif
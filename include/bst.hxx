@@ -8,26 +8,50 @@
 #include <utility>
 #include <memory>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <iterator>
+#include <fstream>
+#include <tuple>
 
 
 #ifndef BST_HXX__
 #define BST_HXX__
 
+#include "balance.hxx"
+#include "allocator.hxx"
+#include "frozen.hxx"
+#include "serialize.hxx"
+
 //pre-declaration needed for the iterator class
-template<class KeyType, class ValueType, class CompareType = std::less<KeyType>>
+template<class KeyType, class ValueType, class CompareType = std::less<KeyType>,
+         class BalancePolicy = no_balance, template<class> class NodeAllocator = pool_allocator>
 class bst;
 
 #include "iterator.hxx"
 
-template<class KeyType, class ValueType, class CompareType>
+template<class KeyType, class ValueType, class CompareType, class BalancePolicy,
+         template<class> class NodeAllocator>
 class bst 
 {
     
     private:
         class Node;
-        std::unique_ptr<Node> root;
+        /**
+         * allocator providing the memory of the nodes, which are owned by the tree
+         */
+        NodeAllocator<Node> allocator;
+        Node *root{nullptr};
+        /**
+         * the node with the largest key, or nullptr if it has not been looked
+         * for since it was erased; it lets insertions at the end of the tree
+         * skip the search from the root
+         */
+        Node *last{nullptr};
         using iterator = __iterator<Node,KeyType,ValueType,CompareType,false>;
         using const_iterator = __iterator<Node,KeyType,ValueType,CompareType,true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
         /**
          * @brief Given a node in a tree, returns its successor
@@ -45,12 +69,85 @@ class bst
          */
         Node *leftmost(Node * node) const;
 
+        /**
+         * @brief Given a pointer to a node, find the rightmost element in the sub-tree
+         * with node as root
+         * @param node Pointer to a node
+         * @return Pointer to a node which is the rightmost element of the sub-tree rooted
+         * in node
+         */
+        Node *rightmost(Node * node) const
+        {
+            while (node && node->get_right())
+            {
+                node = node->get_right();
+            }
+            return node;
+        }
+
 
         /**
-         * @brief Recursive private method to create deep copy of a binary search tree
+         * @brief Private method to create deep copy of a binary search tree.
+         * The nodes are cloned one by one keeping the same structure (and
+         * balancing information) of the original tree, without searching
+         * for their position. The visit is iterative, so it does not depend
+         * on the height of the tree.
          * @param node The root node of the tree that should be copied
          */
-        void copy(const std::unique_ptr<Node> &node);
+        void copy(const Node *node);
+
+        /**
+         * @brief Destroys all the nodes of the sub-tree rooted in node with an
+         * iterative post-order visit. The sub-tree must be detached from the tree.
+         * @param node Pointer to the root of the sub-tree
+         */
+        void destroy_subtree(Node* node) noexcept;
+
+        /**
+         * @brief Recursive private method that builds a perfectly balanced tree
+         * out of the next n elements of a sorted sequence, in linear time
+         * @param first Iterator to the next element of the sequence, it is
+         * advanced past the elements consumed
+         * @param n Number of elements to be consumed
+         * @return Pointer to the root of the tree built
+         */
+        template<class ForwardIt>
+        Node* build_sorted(ForwardIt& first, std::size_t n);
+
+        /**
+         * @brief Turns the tree into a vine (every node has only a right child)
+         * with right rotations, as in the first phase of the Day-Stout-Warren algorithm
+         * @return Number of nodes of the tree
+         */
+        std::size_t tree_to_vine();
+
+        /**
+         * @brief Performs count left rotations along the right spine of the tree,
+         * one every two nodes, starting from the root
+         * @param count Number of rotations
+         */
+        void compress(std::size_t count);
+
+        /**
+         * @brief Recomputes the balancing information of every node, from
+         * the leaves up to the root
+         */
+        void refresh() noexcept;
+
+        /**
+         * @brief Allocates a new node through the allocator and constructs it in-place
+         * @param args Arguments forwarded to the constructor of Node
+         * @return Pointer to the new node, which is not attached to the tree
+         */
+        template<class... Types>
+        Node* create_node(Types&&... args);
+
+        /**
+         * @brief Destroys a node and gives its memory back to the allocator.
+         * The node must already be detached from the tree.
+         * @param node Pointer to the node to be destroyed
+         */
+        void destroy_node(Node* node) noexcept;
 
         /**
          * @brief Function that swapes the two nodes inside the tree topology
@@ -60,27 +157,197 @@ class bst
         void swap(Node* successor, Node* current);
 
         /**
-         * @brief Auxiliary recursive function for erasing a node in tree rooted in the node passed
+         * @brief Auxiliary function for erasing a node in tree rooted in the node passed
          * @param key The key of the node to be deleted
          * @param node Pointer to the root of the (sub-)tree to search the node in.
          */
         void erase_aux(const KeyType& key, Node* node);
 
+        /**
+         * @brief Removes a node from the tree without destroying it, and restores
+         * the balance. A node with two children first takes the place of its
+         * successor, so that it has at most one child when it is removed.
+         * @param current Pointer to the node, which is left detached and with
+         * the balancing information of a tree made of it alone
+         */
+        void unlink(Node* current);
+
+        /**
+         * @brief Where a key is in the tree, or where a node with that key
+         * would have to be attached
+         */
+        struct position
+        {
+            /**
+             * the node holding the key if found is true, otherwise the node
+             * that would be the parent of the new one (nullptr if the tree is empty)
+             */
+            Node *node;
+            bool found;
+            /**
+             * whether the new node would be the left child of node
+             */
+            bool left;
+        };
+
+        /**
+         * @brief Searches a key from the root
+         * @param key The key to be searched
+         * @return The position of the key
+         */
+        template<class K>
+        position locate(const K& key) const;
+
+        /**
+         * @brief Searches a key, checking first whether it goes right before
+         * hint: in that case the position is found without searching from the
+         * root, so that a sequence of insertions at the end takes amortized
+         * constant time to find where each key goes
+         * @param hint Pointer to the node the key should precede, nullptr for end()
+         * @param key The key to be searched
+         * @return The position of the key
+         */
+        position locate_near(Node* hint, const KeyType& key);
+
+        /**
+         * @brief Attaches a new node where locate said its key goes, and
+         * restores the balance
+         * @param where The position returned by locate for the key of node
+         * @param node Pointer to the node, which must be detached
+         * @return Iterator to the node
+         */
+        iterator attach(position where, Node* node);
+
+        /**
+         * @brief Tells whether emplace has been given a key and the arguments of
+         * a value, which allows it to search the key before building anything
+         */
+        template<class... Types>
+        static constexpr bool key_and_value() noexcept
+        {
+            if constexpr (sizeof...(Types) == 2)
+            {
+                return std::is_same<typename std::decay<typename std::tuple_element<0, std::tuple<Types...>>::type>::type,
+                                    KeyType>::value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
         /**
          * @brief Find the node of given key
-         * @param key The key value to be found in bst
+         * @param key The key value to be found in bst, of any type the comparator
+         * can compare with KeyType
          * @param current Pointer to the root of the (sub-)tree to search the node in.
          * @return Iterator to the found node (to nullptr if the node is not found)
          */
-        iterator find_aux(const KeyType& key, Node *current);
+        template<class K>
+        iterator find_aux(const K& key, Node *current);
 
         /**
          * @brief Find the node of given key
-         * @param key The key value to be found in bst
+         * @param key The key value to be found in bst, of any type the comparator
+         * can compare with KeyType
          * @param current Pointer to the root of the (sub-)tree to search the node in.
          * @return Const-iterator to the found node (to nullptr if the node is not found)
          */
-        const_iterator find_aux(const KeyType& key, Node *current) const;
+        template<class K>
+        const_iterator find_aux(const K& key, Node *current) const;
+
+        /**
+         * @brief Left rotation of the sub-tree rooted in node: the right child
+         * of node takes its place and node becomes its left child
+         * @param node Pointer to the root of the sub-tree to be rotated
+         * @return Pointer to the new root of the sub-tree
+         */
+        Node* rotate_left(Node* node);
+
+        /**
+         * @brief Right rotation of the sub-tree rooted in node: the left child
+         * of node takes its place and node becomes its right child
+         * @param node Pointer to the root of the sub-tree to be rotated
+         * @return Pointer to the new root of the sub-tree
+         */
+        Node* rotate_right(Node* node);
+
+        /**
+         * @brief Recomputes the balancing information stored in node
+         * from the one of its children
+         * @param node Pointer to the node to be updated
+         */
+        void update(Node* node) noexcept;
+
+        /**
+         * @brief Restores the balance of the sub-tree rooted in node,
+         * assuming that both of its children are balanced
+         * @param node Pointer to the root of the sub-tree
+         * @return Pointer to the (possibly new) root of the sub-tree
+         */
+        Node* rebalance(Node* node);
+
+        /**
+         * @brief Walks from node up to the root, restoring the balance of every
+         * sub-tree along the path. It must be called after a node has been
+         * attached to or removed from node. It does nothing if the policy
+         * stores no information in the nodes.
+         * @param node Pointer to the lowest node whose sub-tree has changed
+         */
+        void retrace(Node* node);
+
+        /**
+         * @brief Number of nodes of the sub-tree rooted in node, as stored
+         * in the node by the order_statistics policy
+         * @param node Pointer to the root of the sub-tree (possibly null)
+         * @return The number of nodes, 0 if node is null
+         */
+        static std::size_t subtree_size(const Node* node) noexcept
+        {
+            return node ? node->size : 0;
+        }
+
+        /**
+         * @brief Finds the first node whose key is not less than (or, if upper
+         * is true, greater than) key
+         * @param key The key to be compared, of any type the comparator can
+         * compare with KeyType
+         * @param upper Whether to look for the first key greater than key
+         * @return Pointer to the node, nullptr if there is no such node
+         */
+        template<class K>
+        Node* bound(const K& key, bool upper) const;
+
+        /**
+         * number of searches advanced together by search_batch
+         */
+        static constexpr std::size_t batch_width = 16;
+
+        /**
+         * @brief Searches several keys at once. The searches are interleaved:
+         * each round moves every pending search one level down and prefetches
+         * the node it will compare next, so that the cache misses of different
+         * searches overlap instead of being paid one after the other.
+         * @param keys Random access iterator to the keys
+         * @param order Positions of the keys to be searched, in the order they
+         * have to be searched (nullptr to search keys[0], ..., keys[n - 1])
+         * @param n Number of keys to be searched
+         * @param found Where to store, for each searched key, the pointer to
+         * its node (nullptr if the key is not in the tree)
+         */
+        template<class RandomIt>
+        void search_batch(RandomIt keys, const std::size_t* order, std::size_t n, Node** found) const;
+
+        /**
+         * @brief Searches all the keys of a range with search_batch and passes
+         * each resulting node, in the order of the range, to emit
+         * @param first Random access iterator to the first key
+         * @param last Random access iterator past the last key
+         * @param sort_keys Whether to search the keys by increasing order
+         * @param emit Function called on the node found for each key
+         */
+        template<class RandomIt, class Emit>
+        void batch(RandomIt first, RandomIt last, bool sort_keys, Emit emit) const;
     public:
         CompareType comparator;
         
@@ -95,22 +362,46 @@ class bst
          * @param c The instance of the CompareType
          */
         bst(std::pair<KeyType, ValueType> data, CompareType c = CompareType{}):
-            root{std::make_unique<Node>(data)}, comparator{c} {}
+            root{create_node(std::move(data))}, last{root}, comparator{c} {}
 
         /**
          * @brief copy constructor
          * @param bst A reference to another bst
          */
-        bst(const bst& bst)
+        bst(const bst& bst) : comparator{bst.comparator}
         {    
             copy(bst.root);
         }
+
+        /**
+         * @brief Constructor from a range of pairs sorted by key, without
+         * duplicated keys. The tree is built perfectly balanced in linear time.
+         * @param first Forward iterator to the first pair
+         * @param last Forward iterator past the last pair
+         * @param c The instance of the CompareType
+         */
+        template<class ForwardIt>
+        bst(ForwardIt first, ForwardIt last, CompareType c = CompareType{}) : comparator{c}
+        {
+            assign(first, last);
+        }
         /**
          * @brief move constructor
          * @param bst Bst to be moved to the new one
          */
         bst(bst&& bst) noexcept : 
-            root{std::move(bst.root)} {}
+            allocator{std::move(bst.allocator)},
+            root{std::exchange(bst.root, nullptr)},
+            last{std::exchange(bst.last, nullptr)},
+            comparator{std::move(bst.comparator)} {}
+
+        /**
+         * @brief Destructor, it frees all the nodes through clear()
+         */
+        ~bst() noexcept
+        {
+            clear();
+        }
         
         /**
          * @brief Method that generates an iterator
@@ -119,7 +410,7 @@ class bst
          */
         iterator begin() noexcept
         {
-            return iterator{leftmost(root.get())};
+            return iterator{leftmost(root), &root};
         }
 
         /**
@@ -129,7 +420,7 @@ class bst
          */
         const_iterator begin() const noexcept
         {
-            const_iterator it{leftmost(root.get())};
+            const_iterator it{leftmost(root), &root};
             return it;
         }
 
@@ -140,7 +431,7 @@ class bst
          */
         const_iterator cbegin() const noexcept
         {
-            const_iterator it{leftmost(root.get())};
+            const_iterator it{leftmost(root), &root};
             return it;
         }
 
@@ -148,7 +439,7 @@ class bst
          * @brief Method that returns an iterator to nullptr
          * @return Iterator to nullptr
          */
-        iterator end() noexcept { return iterator{nullptr}; }
+        iterator end() noexcept { return iterator{nullptr, &root}; }
 
         /**
          * @brief Method that returns a const-iterator to nullptr
@@ -156,7 +447,7 @@ class bst
          */
         const_iterator end() const noexcept
         {
-            const_iterator it{nullptr};
+            const_iterator it{nullptr, &root};
             return it;
         }
 
@@ -166,10 +457,49 @@ class bst
          */
         const_iterator cend() const noexcept
         {         
-            const_iterator it{nullptr};    
+            const_iterator it{nullptr, &root};    
             return it; 
         }
 
+        /**
+         * @brief Method that generates a reverse iterator
+         * @return A reverse iterator to the last element of the bst
+         *         according to the in-order visit
+         */
+        reverse_iterator rbegin() noexcept { return reverse_iterator{end()}; }
+
+        /**
+         * @brief Method that generates a const reverse iterator
+         * @return A const reverse iterator to the last element of the bst
+         *         according to the in-order visit
+         */
+        const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{end()}; }
+
+        /**
+         * @brief Method that generates a const reverse iterator
+         * @return A const reverse iterator to the last element of the bst
+         *         according to the in-order visit
+         */
+        const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator{cend()}; }
+
+        /**
+         * @brief Method that returns a reverse iterator past the first element
+         * @return Reverse iterator past the first element
+         */
+        reverse_iterator rend() noexcept { return reverse_iterator{begin()}; }
+
+        /**
+         * @brief Method that returns a const reverse iterator past the first element
+         * @return Const reverse iterator past the first element
+         */
+        const_reverse_iterator rend() const noexcept { return const_reverse_iterator{begin()}; }
+
+        /**
+         * @brief Method that returns a const reverse iterator past the first element
+         * @return Const reverse iterator past the first element
+         */
+        const_reverse_iterator crend() const noexcept { return const_reverse_iterator{cbegin()}; }
+
         /**
          *  @brief Insert the node of given key
          *  @param data Pair data to be inserted
@@ -185,21 +515,303 @@ class bst
         std::pair<iterator, bool> insert(std::pair<const KeyType, ValueType>&& data);      
 
         /**
-         *  @brief emplace given data to tree specified position
+         *  @brief Insert the node of given key, as close as possible to the position
+         *  just before hint. If the key goes right before hint the position is found
+         *  without searching from the root: inserting sorted keys one after the
+         *  other with end() as hint takes amortized constant time (plus, with
+         *  the order_statistics policy, the update of the sizes up to the root).
+         *  @param hint Const-iterator to the element the key should precede
+         *  @param data Pair data to be inserted
+         *  @return Iterator to the element with the key of data
+         */
+        iterator insert(const_iterator hint, const std::pair<const KeyType, ValueType>& data)
+        {
+            position where = locate_near(hint.current, data.first);
+            return where.found ? iterator{where.node, &root} : attach(where, create_node(data));
+        }
+
+        /**
+         *  @brief Insert the node of given key, as close as possible to the position
+         *  just before hint, see insert(const_iterator, const std::pair<const KeyType, ValueType>&)
+         *  @param hint Const-iterator to the element the key should precede
+         *  @param data r-value of the pair data to be inserted
+         *  @return Iterator to the element with the key of data
+         */
+        iterator insert(const_iterator hint, std::pair<const KeyType, ValueType>&& data)
+        {
+            position where = locate_near(hint.current, data.first);
+            return where.found ? iterator{where.node, &root} : attach(where, create_node(std::move(data)));
+        }
+
+        /**
+         *  @brief emplace given data to tree specified position. Given a key
+         *  and the arguments of a value it behaves as try_emplace, otherwise
+         *  the pair is built directly in a new node, which is destroyed if the
+         *  key is already in the tree.
          *  @param args The data to be inserted
          *  @return A pair (iterator, bool)
          */
         template<class... Types>
         std::pair<iterator,bool> emplace(Types&&... args)
         {
-            return insert(std::pair<const KeyType, ValueType>{std::forward<Types>(args)...});
+            if constexpr (key_and_value<Types...>())
+            {
+                return try_emplace(std::forward<Types>(args)...);
+            }
+            else
+            {
+                Node *node = create_node(std::forward<Types>(args)...);
+                position where = locate(node->get_data().first);
+                if (where.found)
+                {
+                    destroy_node(node);
+                    return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+                }
+                return std::pair<iterator, bool>{attach(where, node), true};
+            }
+        }
+
+        /**
+         *  @brief Inserts a value built from args, unless the key is already in the
+         *  tree: in that case nothing is built, and args are not moved from.
+         *  @param key The key of the node to be inserted
+         *  @param args The arguments of the constructor of the value
+         *  @return A pair (iterator to the element with the key, whether it has been inserted)
+         */
+        template<class... Types>
+        std::pair<iterator,bool> try_emplace(const KeyType& key, Types&&... args)
+        {
+            position where = locate(key);
+            if (where.found)
+            {
+                return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+            }
+            return std::pair<iterator, bool>{attach(where, create_node(std::piecewise_construct, std::forward_as_tuple(key),
+                                                                      std::forward_as_tuple(std::forward<Types>(args)...))), true};
+        }
+
+        /**
+         *  @brief Inserts a value built from args, unless the key is already in the
+         *  tree: in that case nothing is built, and neither key nor args are moved from.
+         *  @param key r-value of the key of the node to be inserted
+         *  @param args The arguments of the constructor of the value
+         *  @return A pair (iterator to the element with the key, whether it has been inserted)
+         */
+        template<class... Types>
+        std::pair<iterator,bool> try_emplace(KeyType&& key, Types&&... args)
+        {
+            position where = locate(key);
+            if (where.found)
+            {
+                return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+            }
+            return std::pair<iterator, bool>{attach(where, create_node(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                                                                      std::forward_as_tuple(std::forward<Types>(args)...))), true};
+        }
+
+        /**
+         *  @brief Assigns value to the element with the given key, inserting it
+         *  if the key is not in the tree
+         *  @param key The key of the element
+         *  @param value The value to be assigned
+         *  @return A pair (iterator to the element, true if it has been inserted, false if assigned)
+         */
+        template<class M>
+        std::pair<iterator,bool> insert_or_assign(const KeyType& key, M&& value)
+        {
+            position where = locate(key);
+            if (where.found)
+            {
+                where.node->get_data().second = std::forward<M>(value);
+                return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+            }
+            return std::pair<iterator, bool>{attach(where, create_node(key, std::forward<M>(value))), true};
+        }
+
+        /**
+         *  @brief Assigns value to the element with the given key, inserting it
+         *  if the key is not in the tree
+         *  @param key r-value of the key of the element
+         *  @param value The value to be assigned
+         *  @return A pair (iterator to the element, true if it has been inserted, false if assigned)
+         */
+        template<class M>
+        std::pair<iterator,bool> insert_or_assign(KeyType&& key, M&& value)
+        {
+            position where = locate(key);
+            if (where.found)
+            {
+                where.node->get_data().second = std::forward<M>(value);
+                return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+            }
+            return std::pair<iterator, bool>{attach(where, create_node(std::move(key), std::forward<M>(value))), true};
+        }
+
+        /**
+         * @brief Handle owning a node extracted from a tree (see extract), which
+         * can be inserted into another tree of the same type, or back into the
+         * same one, without allocating a new node. An empty handle owns nothing.
+         * The handle keeps alive the memory of the tree it was extracted from
+         * (see NodeAllocator::share), so it can outlive that tree.
+         */
+        class node_type
+        {
+            friend class bst;
+            private:
+                Node *node{nullptr};
+                /**
+                 * allocator keeping the memory of the node valid
+                 */
+                NodeAllocator<Node> memory;
+
+                node_type(Node *node, NodeAllocator<Node>&& memory) noexcept : node{node}, memory{std::move(memory)} {}
+
+                /**
+                 * @brief Destroys the node, if there is one, leaving the handle empty
+                 */
+                void reset() noexcept
+                {
+                    if (node)
+                    {
+                        node->~Node();
+                        memory.deallocate(node);
+                    }
+                    node = nullptr;
+                    memory.release();
+                }
+
+            public:
+                node_type() noexcept = default;
+
+                node_type(const node_type&) = delete;
+                node_type& operator=(const node_type&) = delete;
+
+                node_type(node_type&& other) noexcept :
+                    node{std::exchange(other.node, nullptr)},
+                    memory{std::move(other.memory)}
+                {}
+
+                node_type& operator=(node_type&& other) noexcept
+                {
+                    if (this != &other)
+                    {
+                        reset();
+                        node = std::exchange(other.node, nullptr);
+                        memory = std::move(other.memory);
+                    }
+                    return *this;
+                }
+
+                ~node_type()
+                {
+                    reset();
+                }
+
+                /**
+                 * @brief Method to check whether the handle owns no node
+                 * @return True if it is empty, false otherwise
+                 */
+                bool empty() const noexcept { return !node; }
+
+                explicit operator bool() const noexcept { return node; }
+
+                /**
+                 * @brief Key of the node, the handle must not be empty
+                 * @return Const reference to the key
+                 */
+                const KeyType& key() const noexcept { return node->get_data().first; }
+
+                /**
+                 * @brief Value of the node, the handle must not be empty
+                 * @return Reference to the value
+                 */
+                ValueType& mapped() const noexcept { return node->get_data().second; }
+        };
+
+        /**
+         * @brief Result of the insertion of a node handle
+         */
+        struct insert_return_type
+        {
+            /**
+             * the element with the key of the node
+             */
+            iterator position;
+            bool inserted;
+            /**
+             * the node, if it has not been inserted, an empty handle otherwise
+             */
+            node_type node;
+        };
+
+        /**
+         * @brief Removes an element from the tree without destroying it
+         * @param position Const-iterator to the element, it must not be end()
+         * @return A handle owning the node of the element
+         */
+        node_type extract(const_iterator position);
+
+        /**
+         * @brief Removes the element with the given key from the tree without destroying it
+         * @param key The key of the element
+         * @return A handle owning the node of the element, an empty one if the key is not in the tree
+         */
+        node_type extract(const KeyType& key)
+        {
+            Node *node = find_aux(key, root).current;
+            return node ? extract(const_iterator{node, &root}) : node_type{};
+        }
+
+        /**
+         * @brief Inserts the node owned by a handle, unless its key is already in
+         * the tree. The node itself is linked into the tree if its allocator
+         * can deallocate it (see NodeAllocator::shares), that is if it comes
+         * from this tree or the allocator has no state, as heap_allocator;
+         * otherwise its pair is moved into a new node.
+         * @param handle The handle, emptied if the node is inserted
+         * @return The position of the key, whether the node has been inserted,
+         * and the node if it has not
+         */
+        insert_return_type insert(node_type&& handle);
+
+        /**
+         * @brief Moves into this tree the elements of source whose key is not in
+         * this tree, leaving the others in source. As for node handles, the
+         * nodes are relinked as they are if the allocator has no state,
+         * otherwise their pairs are moved into new nodes, so that the two
+         * trees never share memory.
+         * @param source The tree to take the elements from
+         */
+        void merge(bst& source);
+
+        /**
+         * @brief Moves into this tree the elements of source whose key is not in
+         * this tree, see merge(bst&)
+         * @param source r-value of the tree to take the elements from
+         */
+        void merge(bst&& source)
+        {
+            merge(source);
         }
 
 
         /**
-         *  @brief Clears all the elements of the tree
+         *  @brief Clears all the elements of the tree. The nodes are destroyed
+         *  iteratively, so the stack usage does not depend on the height of
+         *  the tree, and if the allocator supports it their memory is freed
+         *  all at once.
          */
-        void clear() noexcept { root.reset(); }
+        void clear() noexcept;
+
+        /**
+         *  @brief Replaces the content of the tree with the pairs in a range sorted
+         *  by key, without duplicated keys. The tree is built perfectly balanced in
+         *  linear time, without searching the position of any element.
+         *  @param first Forward iterator to the first pair
+         *  @param last Forward iterator past the last pair
+         */
+        template<class ForwardIt>
+        void assign(ForwardIt first, ForwardIt last);
 
         /**
          * @brief Function that searches an element inside the tree and returns an iterator.
@@ -208,7 +820,7 @@ class bst
          */
         iterator find(const KeyType& key)
         {
-            return find_aux(key, root.get());
+            return find_aux(key, root);
         }
 
         /**
@@ -218,16 +830,250 @@ class bst
          */
         const_iterator find(const KeyType& key) const
         {
-            return find_aux(key, root.get());
+            return find_aux(key, root);
+        }
+
+        /**
+         * @brief Searches an element by a key of another type, without converting
+         * it to KeyType. Available only if CompareType::is_transparent exists
+         * (as for std::less<>), e.g. to search a std::string_view in a tree of
+         * std::string keys.
+         * @param key A key the comparator can compare with KeyType
+         * @return If the node is found, an iterator pointing to it, end() otherwise.
+         */
+        template<class K, class C = CompareType, class = typename C::is_transparent>
+        iterator find(const K& key)
+        {
+            return find_aux(key, root);
+        }
+
+        /**
+         * @brief Searches an element by a key of another type, see find(const K&)
+         * @param key A key the comparator can compare with KeyType
+         * @return If the node is found, a const_iterator pointing to it, end() otherwise.
+         */
+        template<class K, class C = CompareType, class = typename C::is_transparent>
+        const_iterator find(const K& key) const
+        {
+            return find_aux(key, root);
+        }
+
+        /**
+         * @brief Searches many keys at once, overlapping the memory accesses of
+         * several searches. It gives the same results as calling find on every
+         * key, but it is faster on trees that do not fit in cache.
+         * @param first Random access iterator to the first key
+         * @param last Random access iterator past the last key
+         * @param out Output iterator receiving, for each key in the same order,
+         * an iterator to its element or end() if the key is not in the tree
+         * @param sort_keys If true, the keys are searched by increasing order,
+         * so that close keys find the nodes they share already in cache
+         * @return Output iterator past the last iterator written
+         */
+        template<class RandomIt, class OutputIt>
+        OutputIt find_batch(RandomIt first, RandomIt last, OutputIt out, bool sort_keys = false)
+        {
+            batch(first, last, sort_keys, [&](Node* node) { *out++ = iterator{node, &root}; });
+            return out;
+        }
+
+        /**
+         * @brief Searches many keys at once, see find_batch
+         * @param first Random access iterator to the first key
+         * @param last Random access iterator past the last key
+         * @param out Output iterator receiving, for each key in the same order,
+         * a const-iterator to its element or end() if the key is not in the tree
+         * @param sort_keys If true, the keys are searched by increasing order
+         * @return Output iterator past the last iterator written
+         */
+        template<class RandomIt, class OutputIt>
+        OutputIt find_batch(RandomIt first, RandomIt last, OutputIt out, bool sort_keys = false) const
+        {
+            batch(first, last, sort_keys, [&](Node* node) { *out++ = const_iterator{node, &root}; });
+            return out;
+        }
+
+        /**
+         * @brief Checks whether many keys are in the tree, see find_batch
+         * @param first Random access iterator to the first key
+         * @param last Random access iterator past the last key
+         * @param out Output iterator receiving, for each key in the same order,
+         * true if the key is in the tree and false otherwise
+         * @param sort_keys If true, the keys are searched by increasing order
+         * @return Output iterator past the last value written
+         */
+        template<class RandomIt, class OutputIt>
+        OutputIt contains_batch(RandomIt first, RandomIt last, OutputIt out, bool sort_keys = false) const
+        {
+            batch(first, last, sort_keys, [&](Node* node) { *out++ = node != nullptr; });
+            return out;
+        }
+
+        /**
+         * @brief Finds the first element whose key is not less than key
+         * @param key The key to be compared
+         * @return Iterator to the element, end() if all the keys are less than key
+         */
+        iterator lower_bound(const KeyType& key) { return iterator{bound(key, false), &root}; }
+
+        /**
+         * @brief Finds the first element whose key is not less than key
+         * @param key The key to be compared
+         * @return Const-iterator to the element, end() if all the keys are less than key
+         */
+        const_iterator lower_bound(const KeyType& key) const { return const_iterator{bound(key, false), &root}; }
+
+        /**
+         * @brief Finds the first element whose key is greater than key
+         * @param key The key to be compared
+         * @return Iterator to the element, end() if no key is greater than key
+         */
+        iterator upper_bound(const KeyType& key) { return iterator{bound(key, true), &root}; }
+
+        /**
+         * @brief Finds the first element whose key is greater than key
+         * @param key The key to be compared
+         * @return Const-iterator to the element, end() if no key is greater than key
+         */
+        const_iterator upper_bound(const KeyType& key) const { return const_iterator{bound(key, true), &root}; }
+
+        /**
+         * @brief lower_bound with a key of another type, available only if
+         * CompareType::is_transparent exists
+         * @param key A key the comparator can compare with KeyType
+         * @return Iterator to the first element whose key is not less than key
+         */
+        template<class K, class C = CompareType, class = typename C::is_transparent>
+        iterator lower_bound(const K& key) { return iterator{bound(key, false), &root}; }
+
+        template<class K, class C = CompareType, class = typename C::is_transparent>
+        const_iterator lower_bound(const K& key) const { return const_iterator{bound(key, false), &root}; }
+
+        /**
+         * @brief upper_bound with a key of another type, available only if
+         * CompareType::is_transparent exists
+         * @param key A key the comparator can compare with KeyType
+         * @return Iterator to the first element whose key is greater than key
+         */
+        template<class K, class C = CompareType, class = typename C::is_transparent>
+        iterator upper_bound(const K& key) { return iterator{bound(key, true), &root}; }
+
+        template<class K, class C = CompareType, class = typename C::is_transparent>
+        const_iterator upper_bound(const K& key) const { return const_iterator{bound(key, true), &root}; }
+
+        /**
+         * @brief Range of the elements with a key equivalent to key
+         * @param key The key to be compared
+         * @return The pair (lower_bound(key), upper_bound(key))
+         */
+        std::pair<iterator, iterator> equal_range(const KeyType& key)
+        {
+            return std::pair<iterator, iterator>{lower_bound(key), upper_bound(key)};
+        }
+
+        /**
+         * @brief Range of the elements with a key equivalent to key
+         * @param key The key to be compared
+         * @return The pair (lower_bound(key), upper_bound(key))
+         */
+        std::pair<const_iterator, const_iterator> equal_range(const KeyType& key) const
+        {
+            return std::pair<const_iterator, const_iterator>{lower_bound(key), upper_bound(key)};
+        }
+
+        /**
+         * @brief Number of elements in the tree. It takes constant time with the
+         * order_statistics policy, linear time otherwise.
+         * @return The number of elements
+         */
+        std::size_t size() const noexcept;
+
+        /**
+         * @brief Number of keys less than key. Requires the order_statistics policy.
+         * @param key The key to be compared
+         * @return The position key has, or would have, in the in-order visit
+         */
+        std::size_t rank(const KeyType& key) const;
+
+        /**
+         * @brief Finds the k-th smallest element. Requires the order_statistics policy.
+         * @param k Position of the element in the in-order visit, counting from 0
+         * @return Iterator to the element, end() if k is not less than size()
+         */
+        iterator select(std::size_t k);
+
+        /**
+         * @brief Finds the k-th smallest element. Requires the order_statistics policy.
+         * @param k Position of the element in the in-order visit, counting from 0
+         * @return Const-iterator to the element, end() if k is not less than size()
+         */
+        const_iterator select(std::size_t k) const;
+
+        /**
+         * @brief Number of keys in the half-open interval [first, last).
+         * Requires the order_statistics policy.
+         * @param first The lower end of the interval, included
+         * @param last The upper end of the interval, excluded
+         * @return The number of keys not less than first and less than last
+         */
+        std::size_t count_range(const KeyType& first, const KeyType& last) const
+        {
+            return comparator(first, last) ? rank(last) - rank(first) : 0;
         }
 
+        /**
+         * @brief Creates an immutable snapshot of the tree, laid out for fast
+         * lookups. Later changes to the tree do not affect the snapshot.
+         * @return A frozen_bst holding a copy of all the pairs
+         */
+        frozen_bst<KeyType, ValueType, CompareType> freeze() const
+        {
+            return frozen_bst<KeyType, ValueType, CompareType>{begin(), end(), comparator};
+        }
+
+        /**
+         * @brief Writes the pairs of the tree, in order, in the binary format
+         * described in serialize.hxx. Keys and values are written by
+         * serializer<KeyType> and serializer<ValueType>.
+         * @param os The stream, opened in binary mode
+         * @throw std::runtime_error If the stream cannot be written
+         */
+        void save(std::ostream& os) const;
+
+        /**
+         * @brief Writes the pairs of the tree to a file, see save(std::ostream&)
+         * @param path The path of the file, overwritten if it exists
+         * @throw std::runtime_error If the file cannot be written
+         */
+        void save(const std::string& path) const;
+
+        /**
+         * @brief Replaces the content of the tree with the pairs written by
+         * save. Since they are stored in order, the tree is built perfectly
+         * balanced in linear time, as assign does, without comparing keys
+         * while building it. If an exception is thrown the tree is left empty.
+         * @param is The stream, opened in binary mode
+         * @throw std::runtime_error If the stream does not hold a tree with the
+         * same key and value types, sorted according to the comparator
+         */
+        void load(std::istream& is);
+
+        /**
+         * @brief Replaces the content of the tree with the pairs saved in a
+         * file, see load(std::istream&)
+         * @param path The path of the file
+         * @throw std::runtime_error If the file cannot be read or it does not
+         * hold a tree with the same key and value types
+         */
+        void load(const std::string& path);
+
         /**
          * @brief Given a key, find the node and delete the node
          * @param key The key of the node to be found and deleted
          */
         void erase(const KeyType& key)
         {
-            erase_aux(key, root.get());
+            erase_aux(key, root);
         }
 
         /**
@@ -236,7 +1082,7 @@ class bst
          */
         Node* getRoot() const
         {
-            return root.get();
+            return root;
         }
 
         /**
@@ -262,27 +1108,39 @@ class bst
         bool isBalanced(Node* node);
         
         /**
-         *  @brief function that balance the tree
+         *  @brief function that balance the tree. The nodes are relinked in
+         *  place with the Day-Stout-Warren algorithm: the tree is first turned
+         *  into a vine and then into a complete tree by rotations, in linear
+         *  time and without moving or copying any element.
          */ 
         void balance();
 
         /**
          * @brief Operator [] that returns the Value contained by the node to be searched.
+         * If the key is not in the tree, it is inserted with a value-initialized value.
          * @param key Key to be searched in the tree.
          * @return Value contained by the node with the key passed.
          */
-        ValueType& operator[](const KeyType& key) noexcept;
+        ValueType& operator[](const KeyType& key)
+        {
+            return try_emplace(key).first->second;
+        }
 
         /**
          * @brief Operator [] that returns the Value contained by the node to be searched.
+         * If the key is not in the tree, it is moved into a new node with a
+         * value-initialized value.
          * @param key Key to be searched in the tree.
          * @return Value contained by the node with the key passed.
          */
-        ValueType& operator[](KeyType&& key) noexcept;
+        ValueType& operator[](KeyType&& key)
+        {
+            return try_emplace(std::move(key)).first->second;
+        }
 };
 /*
-template <class KeyType, class ValueType, class CompareType>
-typename bst<KeyType,ValueType,CompareType>::Node * bst<KeyType,ValueType,CompareType>::successor(Node * node) const
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::Node * bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::successor(Node * node) const
 {
     if (node->right)
     {
@@ -299,128 +1157,520 @@ typename bst<KeyType,ValueType,CompareType>::Node * bst<KeyType,ValueType,Compar
     return p;
 }
 */
-template <class KeyType, class ValueType, class CompareType>
-typename bst<KeyType,ValueType,CompareType>::Node * bst<KeyType,ValueType,CompareType>::leftmost(Node * node) const
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::Node * bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::leftmost(Node * node) const
 {
     if (node)
     {
         while (node->get_left())
         {
-            node = node->get_left().get();
+            node = node->get_left();
         }
     }
 
     return node;
 }
 
-template <class KeyType, class ValueType, class CompareType>
-void bst<KeyType,ValueType,CompareType>::copy(const std::unique_ptr<bst<KeyType,ValueType,CompareType>::Node> &node)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::copy(const Node *node)
 {
-    if (node)
+    if (!node)
     {
-        insert(std::forward<const std::pair<const KeyType, ValueType>>(node->get_data()));
-        copy(node->get_left());
-        copy(node->get_right());
+        return;
+    }
+
+    using node_base = typename BalancePolicy::node_base;
+    try
+    {
+        root = create_node(node->get_data());
+        static_cast<node_base&>(*root) = static_cast<const node_base&>(*node);
+
+        // source and its clone are visited together: go down to the first
+        // child not yet cloned, or go back up when both are done
+        Node *current = root;
+        while (node)
+        {
+            if (node->get_left() && !current->get_left())
+            {
+                node = node->get_left();
+                current->set_left(create_node(node->get_data()));
+                current = current->get_left();
+            }
+            else if (node->get_right() && !current->get_right())
+            {
+                node = node->get_right();
+                current->set_right(create_node(node->get_data()));
+                current = current->get_right();
+            }
+            else
+            {
+                static_cast<node_base&>(*current) = static_cast<const node_base&>(*node);
+                node = node->get_parent();
+                current = current->get_parent();
+            }
+        }
+    }
+    catch (...)
+    {
+        clear();
+        throw;
     }
 }
 
-template <class KeyType, class ValueType, class CompareType>
-std::pair<typename bst<KeyType, ValueType, CompareType>::iterator, bool> 
-bst<KeyType, ValueType, CompareType>::insert(const std::pair<const KeyType, ValueType> &data)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::destroy_subtree(Node *node) noexcept
 {
-    // If tree isn't empty, current node will be created
-    Node *current = root.get();
+    // with a pool the memory is given back all at once by clear(),
+    // so the nodes only need to be destroyed
+    constexpr bool bulk = NodeAllocator<Node>::bulk_release;
+
+    // post-order visit without recursion: go down until a leaf is
+    // found, detach it from its parent, destroy it and restart from
+    // the parent
+    Node *current = node;
     while (current)
     {
-        if (comparator(data.first, current->get_data().first))
+        if (current->get_left())
         {
-            if (!current->get_left())
+            current = current->get_left();
+        }
+        else if (current->get_right())
+        {
+            current = current->get_right();
+        }
+        else
+        {
+            Node *parent = current->get_parent();
+            if (current == node)
+            {
+                parent = nullptr;
+            }
+            else if (current->is_left())
+            {
+                parent->detach_left();
+            }
+            else
+            {
+                parent->detach_right();
+            }
+
+            if (bulk)
+            {
+                current->~Node();
+            }
+            else
+            {
+                destroy_node(current);
+            }
+            current = parent;
+        }
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class... Types>
+typename bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::Node *
+bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::create_node(Types&&... args)
+{
+    Node *node = allocator.allocate();
+    try
+    {
+        ::new (static_cast<void*>(node)) Node(std::in_place, std::forward<Types>(args)...);
+    }
+    catch (...)
+    {
+        allocator.deallocate(node);
+        throw;
+    }
+    return node;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::destroy_node(Node *node) noexcept
+{
+    node->~Node();
+    allocator.deallocate(node);
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::clear() noexcept
+{
+    // with a pool, if the nodes have nothing to destroy they do
+    // not even need to be visited
+    if (!NodeAllocator<Node>::bulk_release || !std::is_trivially_destructible<Node>::value)
+    {
+        destroy_subtree(root);
+    }
+
+    root = last = nullptr;
+    allocator.release();
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class ForwardIt>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::assign(ForwardIt first, ForwardIt last)
+{
+    clear();
+    root = build_sorted(first, std::distance(first, last));
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::save(std::ostream& os) const
+{
+    // without the order_statistics policy counting the pairs takes a visit
+    // of the tree: they are counted while they are written, and the header
+    // is written again at the end, unless the stream cannot go back to it
+    std::streampos start = os.tellp();
+    std::uint64_t count = BalancePolicy::subtree_size || start == std::streampos(-1) ? size() : 0, written = 0;
+    save_header header = save_header::make<KeyType, ValueType>(count);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if constexpr (is_raw_serializable<KeyType>::value && is_raw_serializable<ValueType>::value)
+    {
+        // the pairs are written a block at a time; the block is
+        // value-initialized, so that the padding is written as zeros
+        using saved_type = saved_pair<KeyType, ValueType>;
+        constexpr std::size_t block = 4096 / sizeof(saved_type) ? 4096 / sizeof(saved_type) : 1;
+        std::vector<saved_type> buffer(block, saved_type());
+        std::size_t used = 0;
+        for (const auto &pair : *this)
+        {
+            std::memcpy(&buffer[used].first, &pair.first, sizeof(KeyType));
+            std::memcpy(&buffer[used].second, &pair.second, sizeof(ValueType));
+            ++written;
+            if (++used == block)
             {
-                current->set_left(data);
-                iterator it{current->get_left().get()};
-                return std::pair<iterator, bool>{it, true};
+                os.write(reinterpret_cast<const char*>(buffer.data()), used * sizeof(saved_type));
+                used = 0;
             }
+        }
+        os.write(reinterpret_cast<const char*>(buffer.data()), used * sizeof(saved_type));
+    }
+    else
+    {
+        for (const auto &pair : *this)
+        {
+            serializer<KeyType>::write(os, pair.first);
+            serializer<ValueType>::write(os, pair.second);
+            ++written;
+        }
+    }
+
+    if (written != count)
+    {
+        header.count = written;
+        os.seekp(start);
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.seekp(0, std::ios::end);
+    }
+
+    if (!os)
+    {
+        throw std::runtime_error("Cannot write the bst");
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::save(const std::string& path) const
+{
+    std::ofstream os{path, std::ios::binary | std::ios::trunc};
+    if (!os)
+    {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    save(os);
+    os.close();
+    if (!os)
+    {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::load(std::istream& is)
+{
+    clear();
+
+    save_header header;
+    if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        throw std::runtime_error("Not a file written by bst::save");
+    }
+    header.check<KeyType, ValueType>();
+
+    saved_reader<KeyType, ValueType> reader{is, header.count};
+    root = build_sorted(reader, header.count);
+
+    // the tree has been built trusting the order of the pairs: check it
+    auto unordered = std::adjacent_find(begin(), end(), [this](const auto& a, const auto& b) {
+        return !comparator(a.first, b.first);
+    });
+    if (unordered != end())
+    {
+        clear();
+        throw std::runtime_error("The pairs of the saved bst are not sorted according to its comparator");
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::load(const std::string& path)
+{
+    std::ifstream is{path, std::ios::binary};
+    if (!is)
+    {
+        clear();
+        throw std::runtime_error("Cannot open " + path);
+    }
+    load(is);
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class ForwardIt>
+typename bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::Node *
+bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::build_sorted(ForwardIt &first, std::size_t n)
+{
+    if (n == 0)
+    {
+        return nullptr;
+    }
+
+    // the middle element becomes the root, the ones before it the left
+    // sub-tree and the ones after it the right sub-tree
+    Node *left = build_sorted(first, n / 2);
+    Node *node = nullptr;
+    try
+    {
+        node = create_node(*first);
+        ++first;
+        node->set_left(left);
+        node->set_right(build_sorted(first, n - n / 2 - 1));
+    }
+    catch (...)
+    {
+        destroy_subtree(node ? node : left);
+        throw;
+    }
+    update(node);
+    return node;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+std::pair<typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::iterator, bool> 
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::insert(const std::pair<const KeyType, ValueType> &data)
+{
+    position where = locate(data.first);
+    if (where.found)
+    {
+        //the key already exists in the tree
+        return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+    }
+    return std::pair<iterator, bool>{attach(where, create_node(data)), true};
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+std::pair<typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::iterator, bool> 
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::insert(std::pair<const KeyType, ValueType> &&data)
+{
+    position where = locate(data.first);
+    if (where.found)
+    {
+        //the key already exists in the tree
+        return std::pair<iterator, bool>{iterator{where.node, &root}, false};
+    }
+    return std::pair<iterator, bool>{attach(where, create_node(std::move(data))), true};
+}
 
-            current = current->get_left().get();
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class K>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::position
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::locate(const K &key) const
+{
+    Node *current = root;
+    while (current)
+    {
+        if (comparator(key, current->get_data().first))
+        {
+            if (!current->get_left())
+            {
+                return position{current, false, true};
+            }
+            current = current->get_left();
         }
-        else if (comparator(current->get_data().first, data.first))
+        else if (comparator(current->get_data().first, key))
         {
             if (!current->get_right())
             {
-                current->set_right(data);
-                iterator it{current->get_right().get()};
-                return std::pair<iterator, bool>{it, true};
+                return position{current, false, false};
+            }
+            current = current->get_right();
+        }
+        else
+        {
+            return position{current, true, false};
+        }
+    }
+
+    //the tree is empty: the new node becomes the root
+    return position{nullptr, false, false};
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::position
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::locate_near(Node *hint, const KeyType &key)
+{
+    if (!root)
+    {
+        return position{nullptr, false, false};
+    }
+
+    if (!hint)
+    {
+        // the key goes at the end if it is greater than the last one
+        if (!last)
+        {
+            last = rightmost(root);
+        }
+        if (comparator(last->get_data().first, key))
+        {
+            return position{last, false, false};
+        }
+    }
+    else if (comparator(key, hint->get_data().first))
+    {
+        // the key goes right before hint if it is greater than the
+        // predecessor of hint: the new node is either the left child of
+        // hint or the right child of its predecessor
+        if (hint->get_left())
+        {
+            Node *previous = rightmost(hint->get_left());
+            if (comparator(previous->get_data().first, key))
+            {
+                return position{previous, false, false};
             }
+        }
+        else
+        {
+            // the predecessor is the first ancestor hint is on the right of
+            Node *current = hint;
+            while (current->is_left())
+            {
+                current = current->get_parent();
+            }
+            Node *previous = current->get_parent();
+            if (!previous || comparator(previous->get_data().first, key))
+            {
+                return position{hint, false, true};
+            }
+        }
+    }
+
+    // the hint is of no use: search from the root
+    return locate(key);
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::iterator
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::attach(position where, Node *node)
+{
+    if (!where.node)
+    {
+        root = last = node;
+    }
+    else if (where.left)
+    {
+        where.node->set_left(node);
+    }
+    else
+    {
+        where.node->set_right(node);
+        // a node can become the last one only as right child of the last one
+        if (where.node == last)
+        {
+            last = node;
+        }
+    }
+
+    retrace(where.node);
+    return iterator{node, &root};
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::node_type
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::extract(const_iterator position)
+{
+    unlink(position.current);
+    return node_type{position.current, allocator.share()};
+}
 
-            current = current->get_right().get();
-        }
-        else
-        {
-            //the key already exists in the tree
-            iterator it{current};
-            return std::pair<iterator, bool>{it, false};
-        }
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::insert_return_type
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::insert(node_type &&handle)
+{
+    if (handle.empty())
+    {
+        return insert_return_type{end(), false, node_type{}};
+    }
+
+    position where = locate(handle.key());
+    if (where.found)
+    {
+        return insert_return_type{iterator{where.node, &root}, false, std::move(handle)};
     }
 
-    //current is root and it's nullptr
-    root = std::make_unique<Node>(data);
-    iterator it{root.get()};
-    return std::pair<iterator, bool>{it, true};
+    Node *node;
+    if (allocator.shares(handle.memory))
+    {
+        // the memory of the node can be given back through this tree
+        node = std::exchange(handle.node, nullptr);
+        handle.memory.release();
+    }
+    else
+    {
+        node = create_node(std::move(handle.node->get_data()));
+        handle.reset();
+    }
+    return insert_return_type{attach(where, node), true, node_type{}};
 }
 
-template <class KeyType, class ValueType, class CompareType>
-std::pair<typename bst<KeyType, ValueType, CompareType>::iterator, bool> 
-bst<KeyType, ValueType, CompareType>::insert(std::pair<const KeyType, ValueType> &&data)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::merge(bst &source)
 {
-    // If tree isn't empty, cur node will be created
-    Node *current = root.get();
-    using pair_type = std::pair<const KeyType, ValueType>;
+    if (&source == this)
+    {
+        return;
+    }
 
-    while (current)
+    const bool relink = allocator.shares(source.allocator);
+    Node *node = leftmost(source.root);
+    while (node)
     {
-        if (comparator(data.first, current->get_data().first))
+        // the successor is found before node leaves source, unlinking
+        // node moves the other nodes but does not change their order
+        Node *next = (++iterator{node, &source.root}).current;
+
+        position where = locate(node->get_data().first);
+        if (!where.found)
         {
-            if (!current->get_left())
+            if (relink)
             {
-                //current->left = std::make_unique<Node>(
-                //    std::forward<pair_type>(data), current);
-                current->set_left(std::forward<pair_type>(data));
-                iterator it{current->get_left().get()};
-                return std::pair<iterator, bool>{it, true};
+                source.unlink(node);
+                attach(where, node);
             }
-
-            current = current->get_left().get();
-        }
-        else if (comparator(current->get_data().first, data.first))
-        {
-            if (!current->get_right())
+            else
             {
-                //current->right = std::make_unique<Node>(
-                //    std::forward<pair_type>(data), current);
-                current->set_right(std::forward<pair_type>(data));
-                iterator it{current->get_right().get()};
-                return std::pair<iterator, bool>{it, true};
+                attach(where, create_node(std::move(node->get_data())));
+                source.unlink(node);
+                source.destroy_node(node);
             }
-
-            current = current->get_right().get();
-        }
-        else
-        {
-            //the key already exists in the tree
-            iterator it{current};
-            return std::pair<iterator, bool>{it, false};
         }
+        node = next;
     }
-
-    //current is root and it's nullptr
-    root = std::make_unique<Node>(std::forward<pair_type>(data));
-    iterator it{root.get()};
-    return std::pair<iterator, bool>{it, true};
 }
 
-template <class KeyType, class ValueType, class CompareType>
-typename bst<KeyType, ValueType, CompareType>::iterator 
-bst<KeyType, ValueType, CompareType>::find_aux(const KeyType &key, Node *current)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class K>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::iterator 
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::find_aux(const K &key, Node *current)
 {
     // until current equals to null pointer
     while (current)
@@ -428,16 +1678,16 @@ bst<KeyType, ValueType, CompareType>::find_aux(const KeyType &key, Node *current
         // given key is smaller than current go left
         if (comparator(key, current->get_data().first))
         {
-            current = current->get_left().get();
+            current = current->get_left();
         }
         else if (comparator(current->get_data().first, key))
         {
-            current = current->get_right().get();
+            current = current->get_right();
         }
         else
         {
             // it is equal return current one
-            return iterator{current};
+            return iterator{current, &root};
         }
     }
 
@@ -445,9 +1695,10 @@ bst<KeyType, ValueType, CompareType>::find_aux(const KeyType &key, Node *current
     return end();
 }
 
-template <class KeyType, class ValueType, class CompareType>
-typename bst<KeyType, ValueType, CompareType>::const_iterator
-bst<KeyType, ValueType, CompareType>::find_aux(const KeyType &key, Node *current) const
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class K>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::const_iterator
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::find_aux(const K &key, Node *current) const
 {    
     // until current equals to null pointer
     while (current)
@@ -455,16 +1706,16 @@ bst<KeyType, ValueType, CompareType>::find_aux(const KeyType &key, Node *current
         // given key is smaller than current go left
         if (comparator(key, current->get_data().first))
         {
-            current = current->get_left().get();
+            current = current->get_left();
         }
         else if (comparator(current->get_data().first, key))
         {
-            current = current->get_right().get();
+            current = current->get_right();
         }
         else
         {
             // it is equal return current one
-            return const_iterator{current};
+            return const_iterator{current, &root};
         }
     }
 
@@ -472,8 +1723,8 @@ bst<KeyType, ValueType, CompareType>::find_aux(const KeyType &key, Node *current
     return cend();
 }
 
-template <class KeyType, class ValueType, class CompareType>
-void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::swap(Node* successor, Node* current)
 {
     Node *succ_left, *succ_right, *succ_parent, *curr_left, *curr_right, *curr_parent;
 
@@ -483,7 +1734,7 @@ void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
     succ_parent = successor->get_parent();
 
     //detach successor from its parent. If it has no parent (it is root)
-    //we release the ownership of root
+    //we detach it from root
     if (successor->is_right())
     {
         succ_parent->detach_right();
@@ -494,7 +1745,7 @@ void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
     }
     else
     {
-        root.release();
+        root = nullptr;
     }
     
     //Detach current's children
@@ -503,7 +1754,7 @@ void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
     curr_parent = current->get_parent();
 
     //detach current from its parent. If it has no parent (it is root)
-    //we release the ownership of root
+    //we detach it from root
     if (current->is_right())
     {
         curr_parent->detach_right();
@@ -514,7 +1765,7 @@ void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
     }
     else
     {
-        root.release();
+        root = nullptr;
     }
     
     //used to avoid cycles
@@ -540,7 +1791,7 @@ void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
     }
     else
     {
-        root.reset(current);
+        root = current;
     }
     current->set_left(succ_left);
     current->set_right(succ_right);
@@ -558,69 +1809,248 @@ void bst<KeyType, ValueType, CompareType>::swap(Node* successor, Node* current)
     }
     else
     {
-        root.reset(successor);
+        root = successor;
     }
     successor->set_left(curr_left);
     // curr_right would be null if check == true
     successor->set_right(is_succ_child_of_current ? current: curr_right);
+
+    //the balancing information depends on the position in the tree,
+    //so it has to follow the nodes in the swap
+    using node_base = typename BalancePolicy::node_base;
+    std::swap(static_cast<node_base&>(*successor), static_cast<node_base&>(*current));
 }
 
-template <class KeyType, class ValueType, class CompareType>
-void bst<KeyType, ValueType, CompareType>::erase_aux(const KeyType &key, Node* node)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node*
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::rotate_left(Node* node)
 {
-    
-    Node* current = find_aux(key, node).current;
-    if (!current)
+    Node *parent = node->get_parent();
+    bool was_left = node->is_left();
+    bool was_right = node->is_right();
+
+    //detach node from its parent (or from root)
+    if (was_left)
     {
-        return;
+        parent->detach_left();
+    }
+    else if (was_right)
+    {
+        parent->detach_right();
+    }
+    else
+    {
+        root = nullptr;
     }
-    Node* parent = current->get_parent();
 
-    //Case 1: current is a leaf
-    if (!current->get_left() && !current->get_right())
+    Node *pivot = node->detach_right();
+    node->set_right(pivot->detach_left());
+    pivot->set_left(node);
+
+    if (was_left)
+    {
+        parent->set_left(pivot);
+    }
+    else if (was_right)
+    {
+        parent->set_right(pivot);
+    }
+    else
+    {
+        root = pivot;
+    }
+
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node*
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::rotate_right(Node* node)
+{
+    Node *parent = node->get_parent();
+    bool was_left = node->is_left();
+    bool was_right = node->is_right();
+
+    //detach node from its parent (or from root)
+    if (was_left)
+    {
+        parent->detach_left();
+    }
+    else if (was_right)
+    {
+        parent->detach_right();
+    }
+    else
+    {
+        root = nullptr;
+    }
+
+    Node *pivot = node->detach_left();
+    node->set_left(pivot->detach_right());
+    pivot->set_right(node);
+
+    if (was_left)
+    {
+        parent->set_left(pivot);
+    }
+    else if (was_right)
+    {
+        parent->set_right(pivot);
+    }
+    else
+    {
+        root = pivot;
+    }
+
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::update(Node* node) noexcept
+{
+    if constexpr (BalancePolicy::self_balancing)
+    {
+        int lh = node->get_left() ? node->get_left()->height : 0;
+        int rh = node->get_right() ? node->get_right()->height : 0;
+        node->height = 1 + std::max(lh, rh);
+    }
+    if constexpr (BalancePolicy::subtree_size)
+    {
+        node->size = 1 + subtree_size(node->get_left()) + subtree_size(node->get_right());
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node*
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::rebalance(Node* node)
+{
+    update(node);
+    if constexpr (BalancePolicy::self_balancing)
     {
-        if (current != root.get())
+        // balance factor of a node: height of the left sub-tree minus
+        // the height of the right one
+        auto factor = [](Node* n) {
+            int lh = n->get_left() ? n->get_left()->height : 0;
+            int rh = n->get_right() ? n->get_right()->height : 0;
+            return lh - rh;
+        };
+
+        int bf = factor(node);
+        if (bf > 1)
         {
-            //if current is left child of its parent
-            if (parent->get_left().get() == current)
+            //left-right case: reduce it to the left-left one
+            if (factor(node->get_left()) < 0)
             {
-                parent->destroy_left();
+                rotate_left(node->get_left());
             }
-            else
+            return rotate_right(node);
+        }
+        if (bf < -1)
+        {
+            //right-left case: reduce it to the right-right one
+            if (factor(node->get_right()) > 0)
             {
-                parent->destroy_right();
+                rotate_right(node->get_right());
             }
-            
+            return rotate_left(node);
         }
-        //if current is the root
-        else
+    }
+    return node;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::retrace(Node* node)
+{
+    if constexpr (BalancePolicy::self_balancing || BalancePolicy::subtree_size)
+    {
+        while (node)
         {
-            root.reset();
-            return;
+            if constexpr (BalancePolicy::self_balancing && !BalancePolicy::subtree_size)
+            {
+                // the ancestors only depend on the height of the sub-tree:
+                // if it has not changed, they need nothing
+                int before = node->height;
+                Node *top = rebalance(node);
+                if (top->height == before)
+                {
+                    return;
+                }
+                node = top->get_parent();
+            }
+            else
+            {
+                node = rebalance(node)->get_parent();
+            }
         }
     }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::erase_aux(const KeyType &key, Node* node)
+{
+    Node* current = find_aux(key, node).current;
+    if (current)
+    {
+        unlink(current);
+        destroy_node(current);
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::unlink(Node* current)
+{
+    if (current == last)
+    {
+        last = nullptr;
+    }
+
     //Case 2: current has both right and left child
-    else if (current->get_left() && current->get_right())
+    if (current->get_left() && current->get_right())
     {
         // We get the successor of the current node, which,
         // in the case current has the right child, is the
         // leftmost node in the subtree rooted in the right child
         // of current
-        Node* successor = leftmost(current->get_right().get());
-        //we swap successor and current
+        Node* successor = leftmost(current->get_right());
+        //we swap successor and current: now current is either
+        //a leaf or a node with only one child
         swap(successor, current);
-        //recursively delete current, which now is either a leaf or a node
-        //with only one child
-        erase_aux(key, current);
+    }
+    Node* parent = current->get_parent();
+
+    //Case 1: current is a leaf
+    if (!current->get_left() && !current->get_right())
+    {
+        if (current != root)
+        {
+            //if current is left child of its parent
+            if (parent->get_left() == current)
+            {
+                parent->detach_left();
+            }
+            else
+            {
+                parent->detach_right();
+            }
+        }
+        //if current is the root
+        else
+        {
+            root = nullptr;
+        }
     }
     //Case 3: current has only one child
     else
     {
         Node* child = (current->get_left()) ? current->detach_left() : current->detach_right();
 
-        if (current != root.get())
+        if (current != root)
         {
-            if (current == parent->get_left().get())
+            if (current == parent->get_left())
             {
                 parent->detach_left();
                 parent->set_left(child);
@@ -633,17 +2063,219 @@ void bst<KeyType, ValueType, CompareType>::erase_aux(const KeyType &key, Node* n
         }
         else
         {
-            root.release();
             child->set_parent(nullptr);
-            root.reset(child);
+            root = child;
+        }
+    }
+
+    retrace(parent);
+    static_cast<typename BalancePolicy::node_base&>(*current) = typename BalancePolicy::node_base{};
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template <class K>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node*
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::bound(const K &key, bool upper) const
+{
+    Node *current = root, *result = nullptr;
+    while (current)
+    {
+        // the key of current is a candidate if it is not less than
+        // (greater than, for the upper bound) key: remember it and look
+        // for a smaller one on the left
+        bool candidate = upper ? comparator(key, current->get_data().first)
+                               : !comparator(current->get_data().first, key);
+        if (candidate)
+        {
+            result = current;
+            current = current->get_left();
+        }
+        else
+        {
+            current = current->get_right();
+        }
+    }
+    return result;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template<class RandomIt>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::search_batch(RandomIt keys, const std::size_t* order, std::size_t n, Node** found) const
+{
+    // node each pending search is at, and positions (in found) of the
+    // searches still pending
+    Node *current[batch_width];
+    std::size_t pending[batch_width];
+
+    for (std::size_t start = 0; start < n; start += batch_width)
+    {
+        std::size_t count = std::min(batch_width, n - start);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            current[i] = root;
+            pending[i] = i;
+            found[start + i] = nullptr;
+        }
+        if (!root)
+        {
+            continue;
+        }
+
+        while (count)
+        {
+            std::size_t still = 0;
+            for (std::size_t j = 0; j < count; ++j)
+            {
+                std::size_t i = pending[j];
+                const KeyType& key = keys[order ? order[start + i] : start + i];
+                Node *node = current[i];
+
+                if (comparator(key, node->get_data().first))
+                {
+                    node = node->get_left();
+                }
+                else if (comparator(node->get_data().first, key))
+                {
+                    node = node->get_right();
+                }
+                else
+                {
+                    found[start + i] = node;
+                    continue;
+                }
+
+                // a search that reached a null child is over, key is missing
+                if (node)
+                {
+#if defined(__GNUC__)
+                    __builtin_prefetch(node);
+#endif
+                    current[i] = node;
+                    pending[still++] = i;
+                }
+            }
+            count = still;
+        }
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+template<class RandomIt, class Emit>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::batch(RandomIt first, RandomIt last, bool sort_keys, Emit emit) const
+{
+    std::size_t n = std::distance(first, last);
+    if (!sort_keys)
+    {
+        Node *found[batch_width];
+        for (std::size_t start = 0; start < n; start += batch_width)
+        {
+            std::size_t count = std::min(batch_width, n - start);
+            search_batch(first + start, nullptr, count, found);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                emit(found[i]);
+            }
+        }
+        return;
+    }
+
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+    {
+        return comparator(first[a], first[b]);
+    });
+
+    // results by sorted position, then given back in the original order
+    std::vector<Node*> found(n), result(n);
+    search_batch(first, order.data(), n, found.data());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        result[order[i]] = found[i];
+    }
+    for (Node *node : result)
+    {
+        emit(node);
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+std::size_t bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::size() const noexcept
+{
+    if constexpr (BalancePolicy::subtree_size)
+    {
+        return subtree_size(root);
+    }
+    else
+    {
+        return std::distance(begin(), end());
+    }
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+std::size_t bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::rank(const KeyType &key) const
+{
+    static_assert(BalancePolicy::subtree_size, "rank requires the order_statistics policy");
+
+    std::size_t result = 0;
+    Node *current = root;
+    while (current)
+    {
+        if (comparator(current->get_data().first, key))
+        {
+            // current and its whole left sub-tree are less than key
+            result += subtree_size(current->get_left()) + 1;
+            current = current->get_right();
         }
+        else
+        {
+            current = current->get_left();
+        }
+    }
+    return result;
+}
+
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::iterator
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::select(std::size_t k)
+{
+    const bst &self = *this;
+    return iterator{self.select(k).current, &root};
+}
 
-        delete current;
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::const_iterator
+bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::select(std::size_t k) const
+{
+    static_assert(BalancePolicy::subtree_size, "select requires the order_statistics policy");
+
+    Node *current = root;
+    while (current)
+    {
+        std::size_t left = subtree_size(current->get_left());
+        if (k < left)
+        {
+            current = current->get_left();
+        }
+        else if (k > left)
+        {
+            // skip current and its left sub-tree
+            k -= left + 1;
+            current = current->get_right();
+        }
+        else
+        {
+            break;
+        }
     }
+    return const_iterator{current, &root};
 }
 
-template <class KeyType, class ValueType, class CompareType>
-std::ostream &operator<<(std::ostream &os, const bst<KeyType,ValueType,CompareType> &x)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+std::ostream &operator<<(std::ostream &os, const bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator> &x)
 {
     for (auto &node : x)
     {
@@ -652,8 +2284,8 @@ std::ostream &operator<<(std::ostream &os, const bst<KeyType,ValueType,CompareTy
     return os;
 }
 
-template <class KeyType, class ValueType, class CompareType>
-void bst<KeyType,ValueType,CompareType>::buildTree(std::vector<std::pair<const KeyType, ValueType>> &nodes, int start, int end)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::buildTree(std::vector<std::pair<const KeyType, ValueType>> &nodes, int start, int end)
 {
     if (start > end)
         return;
@@ -671,19 +2303,19 @@ void bst<KeyType,ValueType,CompareType>::buildTree(std::vector<std::pair<const K
     buildTree(nodes, mid + 1, end);
 }
 
-template <class KeyType, class ValueType, class CompareType>
-int bst<KeyType, ValueType, CompareType>::height(typename bst<KeyType, ValueType, CompareType>::Node* node)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+int bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::height(typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node* node)
 {
     if (!node)
     {
         return 0;
     }
-    return 1 + std::max(height(node->get_left().get()),
-                        height(node->get_right().get()));
+    return 1 + std::max(height(node->get_left()),
+                        height(node->get_right()));
 }
 
-template <class KeyType, class ValueType, class CompareType>
-bool bst<KeyType,ValueType,CompareType>::isBalanced(typename bst<KeyType, ValueType, CompareType>::Node* node)
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+bool bst<KeyType,ValueType,CompareType,BalancePolicy,NodeAllocator>::isBalanced(typename bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node* node)
 {
     if (!node)
     {
@@ -692,120 +2324,93 @@ bool bst<KeyType,ValueType,CompareType>::isBalanced(typename bst<KeyType, ValueT
 
     int lh, rh;
 
-    lh = height(node->get_left().get());
-    rh = height(node->get_right().get());
+    lh = height(node->get_left());
+    rh = height(node->get_right());
 
-    return abs(lh - rh) <= 1 && isBalanced(node->get_left().get()) && isBalanced(node->get_right().get());
+    return abs(lh - rh) <= 1 && isBalanced(node->get_left()) && isBalanced(node->get_right());
 }
 
-template <class KeyType, class ValueType, class CompareType>
-void bst<KeyType, ValueType, CompareType>::balance()
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::balance()
 {
-    std::vector<std::pair<const KeyType, ValueType>> nodes;
-    for(auto& node : *this)
+    std::size_t n = tree_to_vine();
+
+    // number of nodes of the deepest level, which is not full: they
+    // are moved down first so that the rest of the vine has 2^k - 1 nodes
+    std::size_t full = 1;
+    while (full <= n + 1)
     {
-        nodes.push_back(node);
+        full *= 2;
     }
+    full = full / 2 - 1;
+    compress(n - full);
 
-    clear();
+    // each pass halves the length of the right spine
+    for (std::size_t size = full / 2; size > 0; size /= 2)
+    {
+        compress(size);
+    }
 
-    buildTree(nodes, 0, nodes.size() - 1);
+    refresh();
 }
 
-template <class KeyType, class ValueType, class CompareType>
-ValueType& bst<KeyType,ValueType,CompareType>::operator[](const KeyType &key) noexcept
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+std::size_t bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::tree_to_vine()
 {
-    Node *current = root.get();
-
+    std::size_t n = 0;
+    Node *current = root;
     while (current)
     {
-        if (comparator(key, current->get_data().first))
-        {
-            if (!current->get_left())
-            {
-                auto pair = std::pair<const KeyType, ValueType>{key, ValueType{}};
-                current->set_left(std::forward<std::pair<const KeyType, ValueType>>(pair));
-                return current->get_left()->get_data().second;
-            }
-            else
-            {
-                current = current->get_left().get();
-            }
-        }
-        else if (comparator(current->get_data().first, key))
+        if (current->get_left())
         {
-
-            if (!current->get_right())
-            {
-                auto pair = std::pair<const KeyType, ValueType>{key, ValueType{}};
-                current->set_right(std::forward<std::pair<const KeyType, ValueType>>(pair));
-                return current->get_right()->get_data().second;
-            }
-            else
-            {
-                current = current->get_right().get();
-            }
+            // the left child takes the place of current, which
+            // is visited again later as its right child
+            current = rotate_right(current);
         }
         else
         {
-            return current->get_data().second;
+            ++n;
+            current = current->get_right();
         }
     }
+    return n;
+}
 
-    //root is null
-    auto pair = std::pair<const KeyType, ValueType>{key, ValueType{}};
-    root = std::make_unique<Node>(std::forward<std::pair<const KeyType, ValueType>>(pair), nullptr);
-    return root->get_data().second;
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::compress(std::size_t count)
+{
+    Node *current = root;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        current = rotate_left(current)->get_right();
+    }
 }
 
-template <class KeyType, class ValueType, class CompareType>
-ValueType& bst<KeyType,ValueType,CompareType>::operator[](KeyType &&key) noexcept
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy, template<class> class NodeAllocator>
+void bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::refresh() noexcept
 {
-    Node *current = root.get();
-    while (current)
+    if constexpr (BalancePolicy::self_balancing || BalancePolicy::subtree_size)
     {
-        if (comparator(std::forward<KeyType>(key), current->get_data().first))
+        // post-order visit without recursion: a node is updated when
+        // we come back to it from its right sub-tree (or it has none)
+        Node *current = leftmost(root);
+        while (current)
         {
-            if (!current->get_left())
-            {
-                auto pair = std::pair<const KeyType, ValueType>{
-                    std::forward<const KeyType>(key), ValueType{}
-                };
-                current->set_left(std::forward<std::pair<const KeyType, ValueType>>(pair));
-                return current->get_left()->get_data().second;
-            }
-            else
+            if (current->get_right())
             {
-                current = current->get_left().get();
+                current = leftmost(current->get_right());
+                continue;
             }
-        }
-        else if (comparator(current->get_data().first, std::forward<KeyType>(key)))
-        {
 
-            if (!current->get_right())
-            {
-                auto pair = std::pair<const KeyType, ValueType>{
-                    std::forward<const KeyType>(key), ValueType{}
-                };
-                current->set_right(std::forward<std::pair<const KeyType, ValueType>>(pair));
-                return current->get_right()->get_data().second;
-            }
-            else
+            update(current);
+            while (current->is_right() || (current->is_left() && !current->get_parent()->get_right()))
             {
-                current = current->get_right().get();
+                current = current->get_parent();
+                update(current);
             }
-        }
-        else
-        {
-            //element found
-            return current->get_data().second;
+            current = current->get_parent();
         }
     }
-
-    //root is null
-    auto pair = std::pair<const KeyType, ValueType>{std::forward<const KeyType>(key), ValueType{}};
-    root = std::make_unique<Node>(std::forward<std::pair<const KeyType, ValueType>>(pair), nullptr);
-    return root->get_data().second;
 }
 
 
@@ -0,0 +1,914 @@
+/**
+ * concurrent.hxx file
+ * @author: Eros Fabrici
+ * @author: Dogan Can Demirbilek
+ * @author: Alessandro Scardoni
+ **/
+
+#ifndef CONCURRENT_HXX__
+#define CONCURRENT_HXX__
+
+#include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include "allocator.hxx"
+
+/**
+ * @brief Epoch-based reclamation: tells a writer when the nodes it has
+ * unlinked can no longer be reached by any reader.
+ *
+ * A reader announces, in one of the slots, the global epoch it has read
+ * before loading the root, and clears the slot when it is done. A writer
+ * publishes the new root, advances the global epoch and stamps the nodes
+ * it has unlinked with the old one: they can be freed once every active
+ * reader has announced a later epoch.
+ */
+class epoch_domain
+{
+    public:
+        /**
+         * number of readers that can be active at the same time
+         */
+        static constexpr std::size_t slots = 128;
+
+        /**
+         * @brief Announces a new reader, waiting for a free slot if they are all taken
+         * @return The index of the slot, to be passed to leave()
+         */
+        std::size_t enter() noexcept
+        {
+            // each thread starts from its own slot, so that readers
+            // running on different threads do not share cache lines
+            thread_local const std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            std::size_t i = hint % slots;
+            for (;;)
+            {
+                std::uint64_t expected = idle;
+                if (table[i].epoch.compare_exchange_strong(expected, global.load()))
+                {
+                    return i;
+                }
+                i = (i + 1) % slots;
+            }
+        }
+
+        /**
+         * @brief Removes a reader
+         * @param slot The index returned by enter()
+         */
+        void leave(std::size_t slot) noexcept
+        {
+            table[slot].epoch.store(idle);
+        }
+
+        /**
+         * @brief Advances the global epoch
+         * @return The epoch before advancing, to be used as stamp for the
+         * nodes unlinked before this call
+         */
+        std::uint64_t advance() noexcept
+        {
+            return global.fetch_add(1);
+        }
+
+        /**
+         * @brief Nodes stamped with an epoch smaller than the one returned
+         * can be freed
+         * @return The smallest epoch announced by an active reader, or the
+         * global epoch if there are none
+         */
+        std::uint64_t oldest() const noexcept
+        {
+            std::uint64_t result = global.load();
+            for (const slot &s : table)
+            {
+                std::uint64_t epoch = s.epoch.load();
+                if (epoch != idle)
+                {
+                    result = std::min(result, epoch);
+                }
+            }
+            return result;
+        }
+
+    private:
+        /**
+         * value of a slot without reader, epochs start from 1
+         */
+        static constexpr std::uint64_t idle = 0;
+
+        struct alignas(64) slot
+        {
+            std::atomic<std::uint64_t> epoch{idle};
+        };
+
+        slot table[slots];
+        alignas(64) std::atomic<std::uint64_t> global{1};
+};
+
+/**
+ * @brief Ordered map that can be shared by many threads: lookups and
+ * iterations never take a lock nor wait for writers, while writers are
+ * serialized by a mutex.
+ *
+ * The tree is an AVL tree whose published nodes are never modified: a
+ * writer copies the nodes on the path from the root to the one it changes
+ * (path copying), links the copies to the untouched sub-trees, and then
+ * publishes the new root with an atomic store. A reader loads the root
+ * once and sees a consistent version of the whole tree. The nodes left
+ * out of the new version are freed through an epoch_domain once no reader
+ * can still be visiting them. Keys and values must be copyable.
+ */
+template<class KeyType, class ValueType, class CompareType = std::less<KeyType>,
+         template<class> class NodeAllocator = pool_allocator>
+class concurrent_bst
+{
+    private:
+        struct Node
+        {
+            std::pair<const KeyType, ValueType> data;
+            Node *left, *right;
+            /**
+             * height of the sub-tree rooted in the node (a leaf has height 1)
+             */
+            int height;
+            /**
+             * number of the write that created the node: until that write is
+             * published the node is not visible to readers and can be modified
+             */
+            std::uint64_t version;
+        };
+
+        std::atomic<Node*> root{nullptr};
+        std::atomic<std::size_t> count{0};
+
+        /**
+         * state used only by writers, while holding the mutex
+         */
+        std::mutex writer;
+        NodeAllocator<Node> allocator;
+        std::uint64_t version{0};
+        /**
+         * nodes created and nodes unlinked by the current write, and nodes
+         * unlinked by the previous ones with the epoch they have been
+         * stamped with
+         */
+        std::vector<Node*> created, unlinked;
+        std::vector<std::pair<std::uint64_t, Node*>> retired;
+
+        mutable epoch_domain epochs;
+
+        /**
+         * @brief RAII announcement of a reader
+         */
+        class guard
+        {
+            private:
+                epoch_domain *epochs;
+                std::size_t slot;
+            public:
+                explicit guard(epoch_domain &epochs) noexcept : epochs{&epochs}, slot{epochs.enter()} {}
+                guard(const guard&) = delete;
+                guard& operator=(const guard&) = delete;
+                ~guard() { epochs->leave(slot); }
+        };
+
+        static int height(const Node *node) noexcept { return node ? node->height : 0; }
+
+        /**
+         * @brief Searches key in the version of the tree rooted in node
+         * @return Pointer to the node holding key, nullptr if there is none
+         */
+        const Node* lookup(const Node *node, const KeyType &key) const
+        {
+            while (node)
+            {
+                if (comparator(key, node->data.first))
+                {
+                    node = node->left;
+                }
+                else if (comparator(node->data.first, key))
+                {
+                    node = node->right;
+                }
+                else
+                {
+                    return node;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief Allocates and constructs a node belonging to the current write
+         * @param data The pair to be stored
+         * @param left Left child
+         * @param right Right child
+         * @return Pointer to the new node
+         */
+        template<class Pair>
+        Node* create_node(Pair &&data, Node *left, Node *right);
+
+        /**
+         * @brief Destroys a node and gives its memory back to the allocator
+         */
+        void destroy_node(Node *node) noexcept
+        {
+            node->~Node();
+            allocator.deallocate(node);
+        }
+
+        /**
+         * @brief Removes a node from the version being built: it is freed
+         * when no reader can see it anymore
+         */
+        void retire(Node *node)
+        {
+            unlinked.push_back(node);
+        }
+
+        /**
+         * @brief Gives a node that the current write can modify: the node
+         * itself if the current write has created it, a copy otherwise
+         */
+        Node* writable(Node *node)
+        {
+            if (node->version == version)
+            {
+                return node;
+            }
+            Node *copy = create_node(node->data, node->left, node->right);
+            copy->height = node->height;
+            retire(node);
+            return copy;
+        }
+
+        static void update(Node *node) noexcept
+        {
+            node->height = 1 + std::max(height(node->left), height(node->right));
+        }
+
+        Node* rotate_left(Node *node);
+        Node* rotate_right(Node *node);
+
+        /**
+         * @brief Restores the AVL property in the sub-tree rooted in node,
+         * which must be writable
+         * @return The new root of the sub-tree
+         */
+        Node* rebalance(Node *node);
+
+        template<class Pair>
+        Node* insert_aux(Node *node, Pair &&data, bool &inserted);
+
+        Node* erase_aux(Node *node, const KeyType &key, bool &erased);
+
+        /**
+         * @brief Unlinks the node with the smallest key from the sub-tree
+         * rooted in node
+         * @param min Set to the node unlinked, which is retired by the caller
+         * @return The new root of the sub-tree
+         */
+        Node* erase_min(Node *node, Node *&min);
+
+        /**
+         * @brief Makes the version rooted in new_root visible to readers and
+         * frees the nodes that no reader can see anymore
+         */
+        void publish(Node *new_root);
+
+        /**
+         * @brief Called when a write fails with an exception: the nodes it
+         * has created are freed and the published version is left untouched
+         */
+        void abort_write() noexcept
+        {
+            for (Node *node : created)
+            {
+                destroy_node(node);
+            }
+            created.clear();
+            unlinked.clear();
+        }
+
+        /**
+         * @brief Destroys all the nodes of the sub-tree rooted in node
+         */
+        void destroy_subtree(Node *node) noexcept
+        {
+            if (node)
+            {
+                destroy_subtree(node->left);
+                destroy_subtree(node->right);
+                destroy_node(node);
+            }
+        }
+
+    public:
+        class read_view;
+
+        CompareType comparator;
+
+        /**
+         * @brief Default constructor
+         * @param c The instance of the CompareType
+         */
+        explicit concurrent_bst(CompareType c = CompareType{}) : comparator{c} {}
+
+        // the tree is shared by reference between threads
+        concurrent_bst(const concurrent_bst&) = delete;
+        concurrent_bst& operator=(const concurrent_bst&) = delete;
+
+        /**
+         * @brief Destructor. No other thread may be using the tree.
+         */
+        ~concurrent_bst();
+
+        /**
+         *  @brief Insert a pair, if its key is not in the tree yet
+         *  @param data Pair data to be inserted
+         *  @return True if the pair has been inserted, false otherwise
+         */
+        bool insert(const std::pair<const KeyType, ValueType> &data);
+
+        /**
+         *  @brief Insert a pair, if its key is not in the tree yet
+         *  @param data r-value of the pair data to be inserted
+         *  @return True if the pair has been inserted, false otherwise
+         */
+        bool insert(std::pair<const KeyType, ValueType> &&data);
+
+        /**
+         *  @brief emplace given data to tree specified position
+         *  @param args The data to be inserted
+         *  @return True if the pair has been inserted, false otherwise
+         */
+        template<class... Types>
+        bool emplace(Types&&... args)
+        {
+            return insert(std::pair<const KeyType, ValueType>{std::forward<Types>(args)...});
+        }
+
+        /**
+         * @brief Given a key, find the node and delete the node
+         * @param key The key of the node to be found and deleted
+         * @return True if the key was in the tree, false otherwise
+         */
+        bool erase(const KeyType &key);
+
+        /**
+         *  @brief Clears all the elements of the tree
+         */
+        void clear();
+
+        /**
+         * @brief Searches key without taking any lock
+         * @param key The key to be searched for
+         * @return A copy of the value associated to key, nothing if the key is not in the tree
+         */
+        std::optional<ValueType> find(const KeyType &key) const
+        {
+            guard g{epochs};
+            const Node *node = lookup(root.load(), key);
+            return node ? std::optional<ValueType>{node->data.second} : std::nullopt;
+        }
+
+        /**
+         * @brief Checks whether key is in the tree without taking any lock
+         * @param key The key to be searched for
+         * @return True if the key is in the tree, false otherwise
+         */
+        bool contains(const KeyType &key) const
+        {
+            guard g{epochs};
+            return lookup(root.load(), key) != nullptr;
+        }
+
+        /**
+         * @brief Number of elements in the tree
+         */
+        std::size_t size() const noexcept { return count.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Creates a consistent read-only view of the current version
+         * of the tree, which can be searched and iterated without locks.
+         * Writers can go on while the view is alive, but the nodes they
+         * unlink are not freed until the view is destroyed, so views should
+         * be short-lived.
+         * @return The view
+         */
+        read_view view() const
+        {
+            return read_view{*this};
+        }
+};
+
+/**
+ * @brief Read-only view of one version of a concurrent_bst, see concurrent_bst::view().
+ */
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+class concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::read_view
+{
+    friend class concurrent_bst;
+    private:
+        const concurrent_bst *tree;
+        epoch_domain *epochs;
+        std::size_t slot;
+        const Node *root;
+
+        explicit read_view(const concurrent_bst &tree) noexcept :
+            tree{&tree}, epochs{&tree.epochs}, slot{tree.epochs.enter()}, root{tree.root.load()} {}
+
+    public:
+        class const_iterator;
+
+        read_view(const read_view&) = delete;
+        read_view& operator=(const read_view&) = delete;
+
+        read_view(read_view &&other) noexcept :
+            tree{other.tree}, epochs{std::exchange(other.epochs, nullptr)}, slot{other.slot}, root{other.root} {}
+
+        read_view& operator=(read_view&&) = delete;
+
+        ~read_view()
+        {
+            if (epochs)
+            {
+                epochs->leave(slot);
+            }
+        }
+
+        /**
+         * @brief Method that generates a const-iterator
+         * @return A const-iterator to the first element according to the in-order visit
+         */
+        const_iterator begin() const
+        {
+            const_iterator it;
+            it.push_left(root);
+            return it;
+        }
+
+        /**
+         * @brief Method that returns the past-the-end const-iterator
+         * @return Const-iterator past the last element
+         */
+        const_iterator end() const noexcept { return const_iterator{}; }
+
+        /**
+         * @brief Function that searches an element inside the view.
+         * @param key The key of the element to be searched for.
+         * @return If the key is found, a const_iterator pointing to it, end() otherwise.
+         */
+        const_iterator find(const KeyType &key) const;
+};
+
+/**
+ * @brief Forward const-iterator of a read_view. Published nodes have no
+ * pointer to their parent, so the iterator keeps the ancestors still to be
+ * visited on a stack.
+ */
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+class concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::read_view::const_iterator
+{
+    friend class read_view;
+    public:
+        using value_type = const std::pair<const KeyType, ValueType>;
+        using reference = value_type&;
+        using pointer = value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        /**
+         * the current node is on the top, below it its ancestors whose
+         * left sub-tree is being visited
+         */
+        std::vector<const Node*> stack;
+
+        void push_left(const Node *node)
+        {
+            while (node)
+            {
+                stack.push_back(node);
+                node = node->left;
+            }
+        }
+
+    public:
+        reference operator*() const noexcept
+        {
+            return stack.back()->data;
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &(*(*this));
+        }
+
+        const_iterator& operator++()
+        {
+            const Node *node = stack.back();
+            stack.pop_back();
+            push_left(node->right);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator it{*this};
+            ++(*this);
+            return it;
+        }
+
+        friend bool operator==(const const_iterator &left, const const_iterator &right) noexcept
+        {
+            const Node *l = left.stack.empty() ? nullptr : left.stack.back();
+            const Node *r = right.stack.empty() ? nullptr : right.stack.back();
+            return l == r;
+        }
+
+        friend bool operator!=(const const_iterator &left, const const_iterator &right) noexcept
+        {
+            return !(left == right);
+        }
+};
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::read_view::const_iterator
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::read_view::find(const KeyType &key) const
+{
+    const_iterator it;
+    const Node *node = root;
+    while (node)
+    {
+        if (tree->comparator(key, node->data.first))
+        {
+            // node comes after the element searched
+            it.stack.push_back(node);
+            node = node->left;
+        }
+        else if (tree->comparator(node->data.first, key))
+        {
+            node = node->right;
+        }
+        else
+        {
+            it.stack.push_back(node);
+            return it;
+        }
+    }
+    return end();
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::~concurrent_bst()
+{
+    destroy_subtree(root.load());
+    for (auto &node : retired)
+    {
+        destroy_node(node.second);
+    }
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+template<class Pair>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::create_node(Pair &&data, Node *left, Node *right)
+{
+    Node *node = allocator.allocate();
+    try
+    {
+        ::new (static_cast<void*>(node)) Node{std::forward<Pair>(data), left, right, 1, version};
+    }
+    catch (...)
+    {
+        allocator.deallocate(node);
+        throw;
+    }
+    try
+    {
+        created.push_back(node);
+    }
+    catch (...)
+    {
+        destroy_node(node);
+        throw;
+    }
+    update(node);
+    return node;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::rotate_left(Node *node)
+{
+    Node *pivot = writable(node->right);
+    node->right = pivot->left;
+    pivot->left = node;
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::rotate_right(Node *node)
+{
+    Node *pivot = writable(node->left);
+    node->left = pivot->right;
+    pivot->right = node;
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::rebalance(Node *node)
+{
+    update(node);
+    int bf = height(node->left) - height(node->right);
+    if (bf > 1)
+    {
+        //left-right case: reduce it to the left-left one
+        if (height(node->left->left) < height(node->left->right))
+        {
+            node->left = rotate_left(writable(node->left));
+        }
+        return rotate_right(node);
+    }
+    if (bf < -1)
+    {
+        //right-left case: reduce it to the right-right one
+        if (height(node->right->right) < height(node->right->left))
+        {
+            node->right = rotate_right(writable(node->right));
+        }
+        return rotate_left(node);
+    }
+    return node;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+template<class Pair>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::insert_aux(Node *node, Pair &&data, bool &inserted)
+{
+    if (!node)
+    {
+        inserted = true;
+        return create_node(std::forward<Pair>(data), nullptr, nullptr);
+    }
+
+    if (comparator(data.first, node->data.first))
+    {
+        Node *left = insert_aux(node->left, std::forward<Pair>(data), inserted);
+        if (!inserted)
+        {
+            return node;
+        }
+        node = writable(node);
+        node->left = left;
+    }
+    else if (comparator(node->data.first, data.first))
+    {
+        Node *right = insert_aux(node->right, std::forward<Pair>(data), inserted);
+        if (!inserted)
+        {
+            return node;
+        }
+        node = writable(node);
+        node->right = right;
+    }
+    else
+    {
+        //the key already exists in the tree
+        inserted = false;
+        return node;
+    }
+    return rebalance(node);
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::erase_min(Node *node, Node *&min)
+{
+    if (!node->left)
+    {
+        min = node;
+        return node->right;
+    }
+    Node *left = erase_min(node->left, min);
+    node = writable(node);
+    node->left = left;
+    return rebalance(node);
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+typename concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::Node*
+concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::erase_aux(Node *node, const KeyType &key, bool &erased)
+{
+    if (!node)
+    {
+        erased = false;
+        return nullptr;
+    }
+
+    if (comparator(key, node->data.first))
+    {
+        Node *left = erase_aux(node->left, key, erased);
+        if (!erased)
+        {
+            return node;
+        }
+        node = writable(node);
+        node->left = left;
+    }
+    else if (comparator(node->data.first, key))
+    {
+        Node *right = erase_aux(node->right, key, erased);
+        if (!erased)
+        {
+            return node;
+        }
+        node = writable(node);
+        node->right = right;
+    }
+    else
+    {
+        erased = true;
+        Node *left = node->left, *right = node->right;
+        retire(node);
+        if (!left || !right)
+        {
+            return left ? left : right;
+        }
+
+        // the successor takes the place of node: as keys are constant,
+        // a new node is created with a copy of its pair
+        Node *min = nullptr;
+        right = erase_min(right, min);
+        node = create_node(min->data, left, right);
+        retire(min);
+    }
+    return rebalance(node);
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+void concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::publish(Node *new_root)
+{
+    // the only step that can fail comes before the new version is visible
+    std::size_t needed = retired.size() + unlinked.size();
+    if (needed > retired.capacity())
+    {
+        retired.reserve(std::max(needed, 2 * retired.capacity()));
+    }
+    created.clear();
+
+    root.store(new_root);
+    std::uint64_t stamp = epochs.advance();
+    for (Node *node : unlinked)
+    {
+        retired.emplace_back(stamp, node);
+    }
+    unlinked.clear();
+
+    // stamps never decrease, so the nodes to be freed are at the front
+    std::uint64_t oldest = epochs.oldest();
+    auto last = retired.begin();
+    while (last != retired.end() && last->first < oldest)
+    {
+        destroy_node(last->second);
+        ++last;
+    }
+    retired.erase(retired.begin(), last);
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+bool concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::insert(const std::pair<const KeyType, ValueType> &data)
+{
+    std::lock_guard<std::mutex> lock{writer};
+    ++version;
+    bool inserted = false;
+    try
+    {
+        Node *new_root = insert_aux(root.load(), data, inserted);
+        if (inserted)
+        {
+            publish(new_root);
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    catch (...)
+    {
+        abort_write();
+        throw;
+    }
+    return inserted;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+bool concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::insert(std::pair<const KeyType, ValueType> &&data)
+{
+    std::lock_guard<std::mutex> lock{writer};
+    ++version;
+    bool inserted = false;
+    try
+    {
+        Node *new_root = insert_aux(root.load(), std::move(data), inserted);
+        if (inserted)
+        {
+            publish(new_root);
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    catch (...)
+    {
+        abort_write();
+        throw;
+    }
+    return inserted;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+bool concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::erase(const KeyType &key)
+{
+    std::lock_guard<std::mutex> lock{writer};
+    ++version;
+    bool erased = false;
+    try
+    {
+        Node *new_root = erase_aux(root.load(), key, erased);
+        if (erased)
+        {
+            publish(new_root);
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    catch (...)
+    {
+        abort_write();
+        throw;
+    }
+    return erased;
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+void concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator>::clear()
+{
+    std::lock_guard<std::mutex> lock{writer};
+    ++version;
+    try
+    {
+        // every node of the current version is unlinked, using unlinked
+        // itself as the queue of the visit
+        std::size_t visited = 0;
+        if (Node *node = root.load())
+        {
+            retire(node);
+        }
+        while (visited < unlinked.size())
+        {
+            Node *node = unlinked[visited++];
+            if (node->left)
+            {
+                retire(node->left);
+            }
+            if (node->right)
+            {
+                retire(node->right);
+            }
+        }
+        publish(nullptr);
+        count.store(0, std::memory_order_relaxed);
+    }
+    catch (...)
+    {
+        abort_write();
+        throw;
+    }
+}
+
+template<class KeyType, class ValueType, class CompareType, template<class> class NodeAllocator>
+std::ostream &operator<<(std::ostream &os, const concurrent_bst<KeyType, ValueType, CompareType, NodeAllocator> &x)
+{
+    auto view = x.view();
+    for (auto &node : view)
+    {
+        os << "(" << node.first << ", " << node.second << ")";
+    }
+    return os;
+}
+
+#endif
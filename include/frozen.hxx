@@ -0,0 +1,319 @@
+/**
+ * frozen.hxx file
+ * @author: Eros Fabrici
+ * @author: Dogan Can Demirbilek
+ * @author: Alessandro Scardoni
+ **/
+
+#ifndef FROZEN_HXX__
+#define FROZEN_HXX__
+
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+/**
+ * @brief Immutable, read-optimized snapshot of a bst, see bst::freeze().
+ *
+ * The keys are kept in an array of their own in Eytzinger order, i.e. the
+ * order of a breadth-first visit of a complete tree: the children of the
+ * element in position k (counting from 1) are in positions 2k and 2k+1.
+ * The first levels of the tree are thus packed in a few cache lines, a
+ * search touches only the keys, and it can prefetch the cache line holding
+ * the keys a few levels below while comparing the current one. The pairs
+ * are kept in a second array in the same order, so that find and the
+ * iterators give access to a real pair like those of bst.
+ * The search loop has no data-dependent branch: the outcome of the
+ * comparison is used as an offset, which compilers turn into a conditional
+ * move/set for arithmetic keys and the usual comparators.
+ */
+template<class KeyType, class ValueType, class CompareType = std::less<KeyType>>
+class frozen_bst
+{
+    private:
+        /**
+         * keys, searched by find, and pairs, in Eytzinger order: the element
+         * in position k (counting from 1) is stored at index k - 1
+         */
+        std::vector<KeyType> keys;
+        std::vector<std::pair<KeyType, ValueType>> pairs;
+
+        /**
+         * @brief Recursive private method that lays out the elements of a sorted
+         * sequence in Eytzinger order, by visiting the implicit tree in order
+         * @param slots For each position, the iterator to the element it must hold
+         * @param k Position of the root of the sub-tree to be visited
+         * @param it Iterator to the next element of the sequence
+         */
+        template<class ForwardIt>
+        void layout(std::vector<ForwardIt>& slots, std::size_t k, ForwardIt& it);
+
+        /**
+         * @brief Branch-free search of the first key not less than key
+         * @param key The key to be searched
+         * @return Its position (counting from 1), 0 if all the keys are smaller
+         */
+        std::size_t search(const KeyType& key) const noexcept;
+
+        /**
+         * @brief Given a position, returns the next one according to the in-order visit
+         * @param k The position (counting from 1)
+         * @return The position of the successor, 0 if k is the last one
+         */
+        std::size_t successor(std::size_t k) const noexcept
+        {
+            if (2 * k + 1 <= keys.size())
+            {
+                // leftmost element of the right sub-tree
+                k = 2 * k + 1;
+                while (2 * k <= keys.size())
+                {
+                    k *= 2;
+                }
+                return k;
+            }
+
+            // go up while k is a right child, then one more step
+            while (k & 1)
+            {
+                k >>= 1;
+            }
+            return k >> 1;
+        }
+
+    public:
+        class const_iterator;
+        using iterator = const_iterator;
+
+        CompareType comparator;
+
+        /**
+         * @brief Default constructor, creates an empty snapshot
+         */
+        frozen_bst() = default;
+
+        /**
+         * @brief Constructor from a range of pairs sorted by key, without
+         * duplicated keys.
+         * @param first Forward iterator to the first pair
+         * @param last Forward iterator past the last pair
+         * @param c The instance of the CompareType
+         */
+        template<class ForwardIt>
+        frozen_bst(ForwardIt first, ForwardIt last, CompareType c = CompareType{});
+
+        /**
+         * @brief Method that generates a const-iterator
+         * @return A const-iterator to the first element according to the in-order visit
+         */
+        const_iterator begin() const noexcept
+        {
+            std::size_t k = keys.empty() ? 0 : 1;
+            while (k && 2 * k <= keys.size())
+            {
+                k *= 2;
+            }
+            return const_iterator{this, k};
+        }
+
+        /**
+         * @brief Method that generates a const-iterator
+         * @return A const-iterator to the first element according to the in-order visit
+         */
+        const_iterator cbegin() const noexcept { return begin(); }
+
+        /**
+         * @brief Method that returns the past-the-end const-iterator
+         * @return Const-iterator past the last element
+         */
+        const_iterator end() const noexcept { return const_iterator{this, 0}; }
+
+        /**
+         * @brief Method that returns the past-the-end const-iterator
+         * @return Const-iterator past the last element
+         */
+        const_iterator cend() const noexcept { return end(); }
+
+        /**
+         * @brief Function that searches an element and returns a const_iterator.
+         * @param key The key of the element to be searched for.
+         * @return If the key is found, a const_iterator pointing to it, end() otherwise.
+         */
+        const_iterator find(const KeyType& key) const noexcept
+        {
+            std::size_t k = search(key);
+            if (k && !comparator(key, keys[k - 1]))
+            {
+                return const_iterator{this, k};
+            }
+            return end();
+        }
+
+        /**
+         * @brief Number of elements of the snapshot
+         * @return The number of elements
+         */
+        std::size_t size() const noexcept { return keys.size(); }
+
+        /**
+         * @brief Method to check whether the snapshot is empty
+         * @return True if there are no elements, false otherwise
+         */
+        bool empty() const noexcept { return keys.empty(); }
+};
+
+/**
+ * @brief Const-iterator of a frozen_bst, visiting the elements by
+ * increasing key. The snapshot cannot be modified, so it points to a
+ * constant std::pair<KeyType, ValueType>.
+ */
+template<class KeyType, class ValueType, class CompareType>
+class frozen_bst<KeyType, ValueType, CompareType>::const_iterator
+{
+    friend class frozen_bst;
+    public:
+        using value_type = std::pair<KeyType, ValueType>;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        const frozen_bst *tree{nullptr};
+        /**
+         * position (counting from 1) of the current element, 0 for end()
+         */
+        std::size_t k{0};
+
+        const_iterator(const frozen_bst *tree, std::size_t k) noexcept : tree{tree}, k{k} {}
+
+    public:
+        const_iterator() = default;
+
+        /**
+         * @brief Operator *iter
+         * @return A const reference to the pair
+         */
+        reference operator*() const noexcept
+        {
+            return tree->pairs[k - 1];
+        }
+
+        pointer operator->() const noexcept
+        {
+            return &**this;
+        }
+
+        /**
+         * @brief Operator ++iter to advance to the next element, basing on InOrder
+         * traversal
+         * @return Reference to this iterator with updated state
+         */
+        const_iterator& operator++() noexcept
+        {
+            k = tree->successor(k);
+            return *this;
+        }
+
+        /**
+         * @brief it++ for iterating to the next element
+         * @return Iterator value before advancing to the next element
+         */
+        const_iterator operator++(int) noexcept
+        {
+            const_iterator it{*this};
+            ++(*this);
+            return it;
+        }
+
+        /**
+         * @brief Operator == to check equality between two iterators
+         * @return True if they point to the same element, false otherwise
+         */
+        friend bool operator==(const const_iterator& left, const const_iterator& right) noexcept
+        {
+            return left.k == right.k;
+        }
+
+        /**
+         * @brief Operator !=, the opposite of ==
+         * @return True if they are not equal, false otherwise.
+         */
+        friend bool operator!=(const const_iterator& left, const const_iterator& right) noexcept
+        {
+            return !(left == right);
+        }
+};
+
+template<class KeyType, class ValueType, class CompareType>
+template<class ForwardIt>
+frozen_bst<KeyType, ValueType, CompareType>::frozen_bst(ForwardIt first, ForwardIt last, CompareType c) :
+    comparator{c}
+{
+    std::size_t n = std::distance(first, last);
+    std::vector<ForwardIt> slots(n + 1);
+    layout(slots, 1, first);
+
+    keys.reserve(n);
+    pairs.reserve(n);
+    for (std::size_t k = 1; k <= n; ++k)
+    {
+        keys.push_back(slots[k]->first);
+        pairs.emplace_back(slots[k]->first, slots[k]->second);
+    }
+}
+
+template<class KeyType, class ValueType, class CompareType>
+template<class ForwardIt>
+void frozen_bst<KeyType, ValueType, CompareType>::layout(std::vector<ForwardIt>& slots, std::size_t k, ForwardIt& it)
+{
+    if (k < slots.size())
+    {
+        layout(slots, 2 * k, it);
+        slots[k] = it;
+        ++it;
+        layout(slots, 2 * k + 1, it);
+    }
+}
+
+template<class KeyType, class ValueType, class CompareType>
+std::size_t frozen_bst<KeyType, ValueType, CompareType>::search(const KeyType& key) const noexcept
+{
+    const std::size_t n = keys.size();
+    const KeyType *base = keys.data();
+    // number of keys per cache line: the descendants of k that are
+    // log2(line) levels below lie next to each other, from line * k on
+    constexpr std::size_t line = 64 / sizeof(KeyType) ? 64 / sizeof(KeyType) : 1;
+
+    std::size_t k = 1;
+    while (k <= n)
+    {
+#if defined(__GNUC__)
+        __builtin_prefetch(base + std::min(line * k, n) - 1);
+#endif
+        k = 2 * k + comparator(base[k - 1], key);
+    }
+
+    // the path went right every time the key was greater, then left once
+    // on the answer: drop the trailing right turns and that left turn
+    while (k & 1)
+    {
+        k >>= 1;
+    }
+    return k >> 1;
+}
+
+template<class KeyType, class ValueType, class CompareType>
+std::ostream &operator<<(std::ostream &os, const frozen_bst<KeyType, ValueType, CompareType> &x)
+{
+    for (auto &node : x)
+    {
+        os << "(" << node.first << ", " << node.second << ")";
+    }
+    return os;
+}
+
+#endif
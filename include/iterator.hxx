@@ -6,7 +6,8 @@
 template<class Node, class KeyType, class ValueType, class CompareType, bool Const>
 class __iterator
 {
-    friend class bst<KeyType, ValueType, CompareType>;
+    template<class, class, class, class, template<class> class> friend class bst;
+    template<class, class, class, class, bool> friend class __iterator;
     public:
         using pair_type = std::pair<const KeyType, ValueType>;
         //if Const = true, then value_type is const pair (const iterator)
@@ -15,13 +16,26 @@ class __iterator
         using reference = value_type&;
         using pointer = value_type*;
         using difference_type = std::ptrdiff_t;
-        using iterator_category = std::forward_iterator_tag;
+        using iterator_category = std::bidirectional_iterator_tag;
 
     private:
         Node * current;
+        /**
+         * pointer to the root of the tree, needed to step back from end()
+         */
+        Node * const * root;
     public:
         __iterator() = default;
-        explicit __iterator(Node * node) noexcept : current{node}
+        __iterator(Node * node, Node * const * root) noexcept : current{node}, root{root}
+            {}
+
+        /**
+         * @brief Conversion from an iterator to a const-iterator
+         * @param other The iterator to be converted
+         */
+        template<bool OtherConst, class = typename std::enable_if<Const && !OtherConst>::type>
+        __iterator(const __iterator<Node,KeyType,ValueType,CompareType,OtherConst>& other) noexcept :
+            current{other.current}, root{other.root}
             {}
 
         /**
@@ -55,6 +69,24 @@ class __iterator
             ++(*this);
             return it;
         }
+
+        /**
+         * @brief Operator --iter to go back to the previous node, basing on InOrder
+         * traversal. Decrementing end() gives the last node.
+         * @return Iterator& Reference to this iterator with updated state
+         */
+        __iterator& operator--() noexcept;
+
+        /**
+         * @brief it-- for going back to the previous node
+         * @return Iterator value before going back to the previous node
+         */
+        __iterator operator--(int) noexcept
+        {
+            __iterator it{*this};
+            --(*this);
+            return it;
+        }
         
         /**
          * @brief Operator == to check equality between two iterators, e.g.
@@ -91,16 +123,51 @@ __iterator<Node,KeyType,ValueType,CompareType,Const>::operator++() noexcept
     }
     else if (current->get_right())
     {
-        current = current->get_right().get();
+        current = current->get_right();
         while (current->get_left())
         {
-            current = current->get_left().get();
+            current = current->get_left();
+        }
+    }
+    else
+    {
+        Node *temp = current->get_parent();
+        while (temp && current == temp->get_right())
+        {
+            current = temp;
+            temp = temp->get_parent();
+        }
+        current = temp;
+    }
+
+    return *this;
+}
+
+template<class Node, class KeyType, class ValueType, class CompareType, bool Const>
+__iterator<Node,KeyType,ValueType,CompareType,Const>& 
+__iterator<Node,KeyType,ValueType,CompareType,Const>::operator--() noexcept
+{
+    if (!current)
+    {
+        // from end() go to the rightmost node
+        current = *root;
+        while (current && current->get_right())
+        {
+            current = current->get_right();
+        }
+    }
+    else if (current->get_left())
+    {
+        current = current->get_left();
+        while (current->get_right())
+        {
+            current = current->get_right();
         }
     }
     else
     {
         Node *temp = current->get_parent();
-        while (temp && current == temp->get_right().get())
+        while (temp && current == temp->get_left())
         {
             current = temp;
             temp = temp->get_parent();
@@ -109,4 +176,4 @@ __iterator<Node,KeyType,ValueType,CompareType,Const>::operator++() noexcept
     }
 
     return *this;
-}
\ No newline at end of file
+}
@@ -8,8 +8,9 @@
 
 #include <cassert> 
 #include <exception>
-template <class KeyType, class ValueType, class CompareType>
-class bst<KeyType, ValueType, CompareType>::Node
+template <class KeyType, class ValueType, class CompareType, class BalancePolicy,
+          template<class> class NodeAllocator>
+class bst<KeyType, ValueType, CompareType, BalancePolicy, NodeAllocator>::Node : public BalancePolicy::node_base
 {
 private:
     /**
@@ -18,9 +19,10 @@ private:
      */
     std::pair<const KeyType, ValueType> data;
     /**
-     * pointers to left and right child
+     * pointers to left and right child. The memory of the nodes is owned
+     * by the tree, which allocates and frees them through its NodeAllocator
      */
-    std::unique_ptr<Node> left, right;
+    Node *left, *right;
     /**
      * pointer to parent node
      */
@@ -33,33 +35,29 @@ public:
     Node() = default;
 
     /**
-     * @brief Construct a new node given a tuple (key,value)
-     * @param data Data to be inserted into the node
+     * @brief Construct a new node, building the tuple (key,value) in place
+     * @param args Arguments forwarded to the constructor of the tuple: a
+     * tuple to be copied or moved, a key and a value, or
+     * std::piecewise_construct and the arguments of key and value
      */
-    Node(std::pair<const KeyType, ValueType> data) : data{data}, left{nullptr}, right{nullptr},
-                                               parent{nullptr} {}
-    /**
-     * @brief Construct a new node given a tuple (key,value)
-     * and a pointer to parent
-     * @param data Data to be inserted inot the node
-     * @param parent Pointer to parent node
-     */
-    Node(std::pair<const KeyType, ValueType> data, Node *parent) : data{data}, left{nullptr}, right{nullptr},
-                                                             parent{parent} {}
+    template<class... Types>
+    explicit Node(std::in_place_t, Types&&... args) : data(std::forward<Types>(args)...), left{nullptr},
+                                                      right{nullptr}, parent{nullptr} {}
 
 
     // no need of a copy constructor
     Node(const Node& node) = delete;
     
     /**
-     * @brief Move constructor.
+     * @brief Move constructor. The links of node are moved as well,
+     * leaving node detached.
      * @param node  rvalue reference to a node
      */
     Node(Node&& node) noexcept :
         data{std::move(node.data)},
-        left{std::move(node.left)},
-        right{std::move(node.right)},
-        parent{std::move(parent)} 
+        left{std::exchange(node.left, nullptr)},
+        right{std::exchange(node.right, nullptr)},
+        parent{std::exchange(node.parent, nullptr)} 
     {}
 
     /**
@@ -69,9 +67,9 @@ public:
     Node& operator=(Node &&node) noexcept
     {
         data = std::move(node.data);
-        left = std::move(node.left);
-        right = std::move(node.right);
-        parent = std::move(node.parent);
+        left = std::exchange(node.left, nullptr);
+        right = std::exchange(node.right, nullptr);
+        parent = std::exchange(node.parent, nullptr);
         return *this;
     }
     
@@ -85,7 +83,7 @@ public:
      */
     bool is_right() const noexcept
     {
-        return (parent && (parent->right.get() == this));
+        return (parent && (parent->right == this));
     }
 
     /**
@@ -95,7 +93,7 @@ public:
      */
     bool is_left() const noexcept
     {
-        return (parent && (parent->left.get() == this));
+        return (parent && (parent->left == this));
     }
 
     /**
@@ -127,36 +125,18 @@ public:
 
     /**
      * @brief Getter for left child
-     * @return Referece to the left child
-     */
-    std::unique_ptr<Node> &get_left() noexcept
-    {
-        return left;
-    }
-
-    /**
-     * @brief Getter for left child
-     * @return Referece to the left child
+     * @return Pointer to the left child
      */
-    const std::unique_ptr<Node> &get_left() const noexcept
+    Node *get_left() const noexcept
     {
         return left;
     }
 
     /**
      * @brief Getter for right child
-     * @return Reference to the right child
-     */
-    std::unique_ptr<Node> &get_right() noexcept
-    {
-        return right;
-    }
-
-    /**
-     * @brief Getter for right child
-     * @return Reference to the right child
+     * @return Pointer to the right child
      */
-    const std::unique_ptr<Node> &get_right() const noexcept
+    Node *get_right() const noexcept
     {
         return right;
     }
@@ -172,11 +152,15 @@ public:
 
     /**
      * @brief Setter for the left node
-     * @param new_node Pointer to the new_node to be inserted
+     * @param new_node Pointer to the new_node to be attached
+     * @throws std::invalid_argument if new_node is equal to the parent of this
+     * @throws std::logic_error if left is not null
+     * 
      * The method will abort if new_node points to the parent of this instance
      * as this would result in creating a cycle between this and new_node.
      * The program is aborted also if left is not null.
-     * If new_node is null, then left is freed and set to null.
+     * If new_node is null, then left is set to null: the node previously
+     * attached is not freed.
      */
     void set_left(Node *new_node)
     {
@@ -191,66 +175,30 @@ public:
              //can be setted iff left is null
             if (left)
             {
-                throw std::invalid_argument("Left node already exists. It is not possible to attach a new one.");
+                throw std::logic_error("Left node already exists. It is not possible to attach a new one.");
             }
 
-            left.reset(new_node);
+            left = new_node;
             left->parent = this;
         }
         else
         {
-            destroy_left();
-        }
-        
-    }
-
-    /**
-     * @brief Setter for the left node by constructing the node in-place
-     * @param data The pair to be inserted into the node
-     * @throws std::logic_error if left already exists
-     */
-    void set_left(std::pair<const KeyType, ValueType> &&data)
-    {
-        if (!left)
-        {
-            left = std::make_unique<Node>(std::forward<std::pair<const KeyType, ValueType>>(data), this);
-        }
-        else
-        {
-            throw std::logic_error("Left node already exists. It is not possible to attach a new one.");
-        }
-        
-    }
-
-    /**
-     * @brief Setter for the left node by constructing the node in-place
-     * @param data The pair to be inserted into the node
-     * @throws std::logic_error if left already exists
-     */
-    
-    void set_left(const std::pair<const KeyType, ValueType> &data)
-    {
-        if (!left)
-        {
-            left = std::make_unique<Node>(data, this);
-        }
-        else
-        {
-            throw std::logic_error("Left node already exists. It is not possible to attach a new one.");
+            left = nullptr;
         }
         
     }
     
     /**
      * @brief Setter for the right node
-     * @param new_node Pointer to the new_node to be inserted
+     * @param new_node Pointer to the new_node to be attached
      * @throws std::invalid_argument if new_node is equal to the parent of this
      * @throws std::logic_error if right is not null
      * 
      * The method will abort if new_node points to the parent of this instance
      * as this would result in creating a cycle between this and new_node.
      * The program is aborted also if right is not null.
-     * If new_node is null, then right is freed and set to null.
+     * If new_node is null, then right is set to null: the node previously
+     * attached is not freed.
      */
     void set_right(Node* new_node)
     {
@@ -262,55 +210,19 @@ public:
 
         if (new_node)
         {
-            //std::cout << data.first << ": hola" << std::endl;
             if (right)
             {
                 throw std::logic_error("Right node already exists. It is not possible to attach a new one.");
             }
-            right.reset(new_node);
+            right = new_node;
             right->parent = this;
         }
         else
         {
-            destroy_right();
+            right = nullptr;
         }
         
     }
-
-    /**
-     * @brief Setter for the right node by constructing the node in-place
-     * @param data The pair to be inserted into the node
-     * @throws std::logic_error if right already exists
-     */
-    void set_right(std::pair<const KeyType, ValueType> &&data)
-    {
-        if (!right)
-        {
-            right = std::make_unique<Node>(std::forward<std::pair<const KeyType, ValueType>>(data), this);
-        }
-        else
-        {
-            throw std::logic_error("Right node already exists. It is not possible to attach a new one.");
-        }
-    }
-
-    /**
-     * @brief Setter for the right node by constructing the node in-place
-     * @param data The pair to be inserted into the node
-     * @throws std::logic_error if right already exists
-     */
-    
-    void set_right(const std::pair<const KeyType, ValueType> &data)
-    {
-        if (!right)
-        {
-            right = std::make_unique<Node>(data, this);
-        }
-        else
-        {
-            throw std::logic_error("Right node already exists. It is not possible to attach a new one.");
-        }
-    }
     
     /**
      * @brief Setter for the parent
@@ -324,15 +236,14 @@ public:
     /**
      * @brief Method that detaches the right.
      * @return Pointer to the detached node.
-     * This method will detach the right child, namely it won't its pointed memory location
+     * This method will detach the right child, namely it won't free its pointed memory location
      */
     Node* detach_right() noexcept
     {
-        Node* ptr = nullptr;
+        Node* ptr = right;
         if (right)
         {
             right->set_parent(nullptr);
-            ptr = right.release();
             right = nullptr;
         }
         return ptr;
@@ -342,15 +253,14 @@ public:
     /**
      * @brief Method that detaches the left child.
      * @return Pointer to the Node detached.
-     * This method will detach the right child, namely it won't its pointed memory location.
+     * This method will detach the left child, namely it won't free its pointed memory location.
      */
     Node* detach_left() noexcept
     {
-        Node* ptr = nullptr;
+        Node* ptr = left;
         if (left)
         {
             left->set_parent(nullptr);
-            ptr = left.release();
             left = nullptr;
         }
         return ptr;
@@ -364,27 +274,4 @@ public:
         detach_right();
         detach_left();
     }
-
-    /**
-     * @brief Method to "destroy" right child (set as null and free the memory)
-     */
-    void destroy_right() noexcept
-    {
-        if (right) 
-        {
-            right.reset();
-        }
-    }
-
-    /**
-     * @brief Method to "destroy" left child (set as null and free the memory)
-     */
-    void destroy_left() noexcept
-    {
-        if (left)
-        {
-            left.reset();
-        }
-        
-    }
 };
@@ -0,0 +1,457 @@
+/**
+ * serialize.hxx file
+ * @author: Eros Fabrici
+ * @author: Dogan Can Demirbilek
+ * @author: Alessandro Scardoni
+ **/
+
+#ifndef SERIALIZE_HXX__
+#define SERIALIZE_HXX__
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <optional>
+#include <utility>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Binary format written by bst::save and read by bst::load and mapped_bst.
+ * A 64-byte save_header is followed by the pairs of the tree in order.
+ * If both the key and the value are stored as raw bytes (see serializer),
+ * every pair is stored as a saved_pair, so that the pairs form an array
+ * that can be searched without decoding it. Otherwise each key is followed
+ * by its value, both written by their serializer.
+ * Raw bytes are stored in the byte order of the machine that wrote them,
+ * files written on a machine with a different byte order are rejected.
+ */
+
+/**
+ * @brief Writes and reads objects of type T. The default one stores the
+ * bytes of trivially copyable types as they are. To save a tree whose keys
+ * or values are of any other type, specialize it with the two static
+ * methods write(std::ostream&, const T&) and T read(std::istream&).
+ */
+template<class T>
+struct serializer
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "serializer<T> must be specialized for types that are not trivially copyable");
+
+    /**
+     * objects are stored as their bytes
+     */
+    static constexpr bool raw = true;
+
+    static void write(std::ostream& os, const T& x)
+    {
+        os.write(reinterpret_cast<const char*>(&x), sizeof(T));
+    }
+
+    static T read(std::istream& is)
+    {
+        T x{};
+        is.read(reinterpret_cast<char*>(&x), sizeof(T));
+        return x;
+    }
+};
+
+/**
+ * @brief Strings are stored as their length followed by their characters
+ */
+template<>
+struct serializer<std::string>
+{
+    /**
+     * characters read at a time: the length comes from the file, so the
+     * string only grows as far as the characters actually found there
+     */
+    static constexpr std::size_t chunk = 4096;
+
+    static void write(std::ostream& os, const std::string& x)
+    {
+        serializer<std::uint64_t>::write(os, x.size());
+        os.write(x.data(), x.size());
+    }
+
+    /**
+     * @throw std::runtime_error If the file ends before the length or the
+     * characters
+     */
+    static std::string read(std::istream& is)
+    {
+        std::uint64_t length = serializer<std::uint64_t>::read(is);
+        std::string x;
+        while (is && x.size() < length)
+        {
+            std::size_t done = x.size();
+            x.resize(done + std::min<std::uint64_t>(chunk, length - done));
+            is.read(&x[done], x.size() - done);
+        }
+        if (!is)
+        {
+            throw std::runtime_error("Unexpected end of file while loading a bst");
+        }
+        return x;
+    }
+};
+
+/**
+ * @brief Tells whether objects of type T are stored as their bytes, i.e.
+ * whether serializer<T> is the default one
+ */
+template<class T, class = void>
+struct is_raw_serializable : std::false_type {};
+
+template<class T>
+struct is_raw_serializable<T, std::void_t<decltype(serializer<T>::raw)>> : std::bool_constant<serializer<T>::raw> {};
+
+/**
+ * @brief How a pair is stored when both key and value are stored as raw bytes
+ */
+template<class KeyType, class ValueType>
+struct saved_pair
+{
+    KeyType first;
+    ValueType second;
+};
+
+/**
+ * @brief Header of a saved tree
+ */
+struct save_header
+{
+    char magic[8];
+    std::uint32_t version;
+    /**
+     * 0x01020304 as written by the machine that saved the tree
+     */
+    std::uint32_t byte_order;
+    /**
+     * 1 if the pairs are stored as an array of saved_pair, 0 otherwise
+     */
+    std::uint32_t raw;
+    /**
+     * sizeof(saved_pair) if raw is 1, 0 otherwise
+     */
+    std::uint32_t pair_size;
+    std::uint32_t key_size, value_size;
+    /**
+     * number of pairs
+     */
+    std::uint64_t count;
+    unsigned char reserved[24];
+
+    static constexpr char expected_magic[8] = {'B', 'S', 'T', 'S', 'A', 'V', 'E', '\0'};
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t expected_byte_order = 0x01020304;
+
+    /**
+     * @brief Header of a tree of count pairs of the given types
+     * @param count The number of pairs
+     * @return The header
+     */
+    template<class KeyType, class ValueType>
+    static save_header make(std::uint64_t count) noexcept
+    {
+        constexpr bool raw = is_raw_serializable<KeyType>::value && is_raw_serializable<ValueType>::value;
+
+        save_header header{};
+        std::copy(expected_magic, expected_magic + 8, header.magic);
+        header.version = current_version;
+        header.byte_order = expected_byte_order;
+        header.raw = raw;
+        header.pair_size = raw ? sizeof(saved_pair<KeyType, ValueType>) : 0;
+        header.key_size = sizeof(KeyType);
+        header.value_size = sizeof(ValueType);
+        header.count = count;
+        return header;
+    }
+
+    /**
+     * @brief Checks that the header describes a tree saved with the given
+     * types on a machine with the same byte order
+     * @throw std::runtime_error If it does not
+     */
+    template<class KeyType, class ValueType>
+    void check() const
+    {
+        save_header expected = make<KeyType, ValueType>(count);
+        if (!std::equal(magic, magic + 8, expected_magic) || version != current_version)
+        {
+            throw std::runtime_error("Not a file written by bst::save");
+        }
+        if (byte_order != expected_byte_order)
+        {
+            throw std::runtime_error("The file was written on a machine with a different byte order");
+        }
+        if (raw != expected.raw || pair_size != expected.pair_size ||
+            key_size != expected.key_size || value_size != expected.value_size)
+        {
+            throw std::runtime_error("The file was written by a tree of different key or value types");
+        }
+    }
+};
+
+static_assert(sizeof(save_header) == 64, "save_header must take 64 bytes");
+
+/**
+ * @brief Reads the pairs of a saved tree one after the other, as a forward
+ * iterator that can be passed (by reference) to bst::build_sorted. Every
+ * pair must be dereferenced once before advancing: dereferencing moves
+ * the pair out of the reader.
+ */
+template<class KeyType, class ValueType>
+class saved_reader
+{
+    private:
+        std::istream& is;
+        std::uint64_t remaining;
+        std::optional<std::pair<KeyType, ValueType>> current;
+
+        /**
+         * @brief Reads the next pair, if there is one left
+         * @throw std::runtime_error If the file ends before it
+         */
+        void next()
+        {
+            if (remaining == 0)
+            {
+                current.reset();
+                return;
+            }
+            --remaining;
+
+            if constexpr (is_raw_serializable<KeyType>::value && is_raw_serializable<ValueType>::value)
+            {
+                saved_pair<KeyType, ValueType> saved = saved_pair<KeyType, ValueType>();
+                is.read(reinterpret_cast<char*>(&saved), sizeof(saved));
+                current.emplace(saved.first, saved.second);
+            }
+            else
+            {
+                KeyType key = serializer<KeyType>::read(is);
+                current.emplace(std::move(key), serializer<ValueType>::read(is));
+            }
+
+            if (!is)
+            {
+                throw std::runtime_error("Unexpected end of file while loading a bst");
+            }
+        }
+
+    public:
+        /**
+         * @brief Reads the first of count pairs from is
+         * @param is The stream, positioned right after the header
+         * @param count The number of pairs to be read
+         */
+        saved_reader(std::istream& is, std::uint64_t count) : is{is}, remaining{count}
+        {
+            next();
+        }
+
+        std::pair<const KeyType, ValueType> operator*()
+        {
+            return std::pair<const KeyType, ValueType>{std::move(current->first), std::move(current->second)};
+        }
+
+        saved_reader& operator++()
+        {
+            next();
+            return *this;
+        }
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @brief Read-only view of a tree saved by bst::save, mapped in memory.
+ * Opening it does not read the file: find and iteration work directly on
+ * the mapped pages, which the operating system loads when they are first
+ * touched and shares among all the processes mapping the same file.
+ * The pairs are sorted by key, so find is a binary search and iteration
+ * a visit of an array. Both key and value must be stored as raw bytes
+ * (see serializer), and the tree must have been saved with the same
+ * comparator.
+ */
+template<class KeyType, class ValueType, class CompareType = std::less<KeyType>>
+class mapped_bst
+{
+    static_assert(is_raw_serializable<KeyType>::value && is_raw_serializable<ValueType>::value,
+                  "mapped_bst needs keys and values stored as raw bytes");
+    static_assert(alignof(saved_pair<KeyType, ValueType>) <= sizeof(save_header),
+                  "the pairs must be aligned right after the header");
+
+    public:
+        using value_type = saved_pair<KeyType, ValueType>;
+        using const_iterator = const value_type*;
+        using iterator = const_iterator;
+
+    private:
+        /**
+         * mapped memory, and its length in bytes
+         */
+        void *address{nullptr};
+        std::size_t length{0};
+        /**
+         * the pairs, stored right after the header
+         */
+        const value_type *pairs{nullptr};
+        std::size_t count{0};
+
+        void unmap() noexcept
+        {
+            if (address)
+            {
+                munmap(address, length);
+            }
+            address = nullptr;
+            pairs = nullptr;
+            length = count = 0;
+        }
+
+    public:
+        CompareType comparator;
+
+        /**
+         * @brief Maps a file written by bst::save
+         * @param path The path of the file
+         * @param c The instance of the CompareType
+         * @throw std::runtime_error If the file cannot be mapped or it does
+         * not hold a tree of the right types
+         */
+        explicit mapped_bst(const std::string& path, CompareType c = CompareType{}) : comparator{c}
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                throw std::runtime_error("Cannot open " + path);
+            }
+            struct stat info;
+            if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(save_header))
+            {
+                close(fd);
+                throw std::runtime_error("Not a file written by bst::save: " + path);
+            }
+            length = info.st_size;
+            address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (address == MAP_FAILED)
+            {
+                address = nullptr;
+                throw std::runtime_error("Cannot map " + path);
+            }
+
+            try
+            {
+                const save_header *header = static_cast<const save_header*>(address);
+                header->check<KeyType, ValueType>();
+                if (header->count > (length - sizeof(save_header)) / sizeof(value_type))
+                {
+                    throw std::runtime_error("Truncated file: " + path);
+                }
+                count = header->count;
+                pairs = reinterpret_cast<const value_type*>(static_cast<const char*>(address) + sizeof(save_header));
+            }
+            catch (...)
+            {
+                unmap();
+                throw;
+            }
+        }
+
+        // the mapping is owned by a single view
+        mapped_bst(const mapped_bst&) = delete;
+        mapped_bst& operator=(const mapped_bst&) = delete;
+
+        mapped_bst(mapped_bst&& other) noexcept :
+            address{std::exchange(other.address, nullptr)},
+            length{std::exchange(other.length, 0)},
+            pairs{std::exchange(other.pairs, nullptr)},
+            count{std::exchange(other.count, 0)},
+            comparator{std::move(other.comparator)}
+        {}
+
+        mapped_bst& operator=(mapped_bst&& other) noexcept
+        {
+            if (this != &other)
+            {
+                unmap();
+                address = std::exchange(other.address, nullptr);
+                length = std::exchange(other.length, 0);
+                pairs = std::exchange(other.pairs, nullptr);
+                count = std::exchange(other.count, 0);
+                comparator = std::move(other.comparator);
+            }
+            return *this;
+        }
+
+        ~mapped_bst()
+        {
+            unmap();
+        }
+
+        /**
+         * @brief Method that generates a const-iterator
+         * @return A const-iterator to the pair with the smallest key
+         */
+        const_iterator begin() const noexcept { return pairs; }
+
+        const_iterator cbegin() const noexcept { return begin(); }
+
+        /**
+         * @brief Method that returns the past-the-end const-iterator
+         * @return Const-iterator past the pair with the largest key
+         */
+        const_iterator end() const noexcept { return pairs + count; }
+
+        const_iterator cend() const noexcept { return end(); }
+
+        /**
+         * @brief Function that searches an element and returns a const_iterator.
+         * @param key The key of the element to be searched for.
+         * @return If the key is found, a const_iterator pointing to it, end() otherwise.
+         */
+        const_iterator find(const KeyType& key) const
+        {
+            const_iterator it = std::lower_bound(begin(), end(), key, [this](const value_type& pair, const KeyType& key) {
+                return comparator(pair.first, key);
+            });
+            return it != end() && !comparator(key, it->first) ? it : end();
+        }
+
+        /**
+         * @brief Number of elements of the saved tree
+         * @return The number of elements
+         */
+        std::size_t size() const noexcept { return count; }
+
+        /**
+         * @brief Method to check whether the saved tree is empty
+         * @return True if there are no elements, false otherwise
+         */
+        bool empty() const noexcept { return count == 0; }
+};
+
+template<class KeyType, class ValueType, class CompareType>
+std::ostream &operator<<(std::ostream &os, const mapped_bst<KeyType, ValueType, CompareType> &x)
+{
+    for (const auto &node : x)
+    {
+        os << "(" << node.first << ", " << node.second << ")";
+    }
+    return os;
+}
+#endif
+
+#endif
@@ -1,73 +1,733 @@
 #include <iostream>
 #include <bst.hxx>
+#include <concurrent.hxx>
 #include <chrono>
 #include <map>
 #include <random>
 #include <fstream>
 #include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <optional>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <iomanip>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
+// Runs ops operations on each of the threads, read_percent of them are
+// lookups and the others insert or erase a random key.
+// Returns the number of operations per second.
+template<class Lookup, class Update>
+double throughput(int threads, int read_percent, int keys, Lookup lookup, Update update)
+{
+    const int ops = 100000;
+    std::vector<std::thread> workers;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]() {
+            std::mt19937 rng(t);
+            std::uniform_int_distribution<int> key(0, keys - 1), percent(0, 99);
+            for (int k = 0; k < ops; ++k)
+            {
+                if (percent(rng) < read_percent)
+                {
+                    lookup(key(rng));
+                }
+                else
+                {
+                    update(key(rng), rng() & 1);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double> elapsed = t1 - t0;
+    return threads * ops / elapsed.count();
+}
+
+// Throughput against the number of threads of a bst protected by a global
+// mutex and of concurrent_bst, for different shares of lookups
+void thread_benchmark()
+{
+    const int keys{100000};
 
-int main() {
+    std::ofstream outFile;
+    outFile.open("../benchmark/benchmark_threads.txt");
+
+    for (int read_percent : {100, 95, 50})
+    {
+        for (int threads = 1; threads <= 8; threads *= 2)
+        {
+            bst<int,int,std::less<int>,avl_balance> b;
+            std::mutex m;
+            concurrent_bst<int,int> c;
+            for (int k = 0; k < keys; k += 2)
+            {
+                b.insert({k, k});
+                c.insert({k, k});
+            }
+
+            double locked = throughput(threads, read_percent, keys,
+                [&](int k) {
+                    std::lock_guard<std::mutex> lock{m};
+                    return b.find(k) != b.end();
+                },
+                [&](int k, bool insert) {
+                    std::lock_guard<std::mutex> lock{m};
+                    if (insert)
+                    {
+                        b.insert({k, k});
+                    }
+                    else
+                    {
+                        b.erase(k);
+                    }
+                });
+
+            double lock_free = throughput(threads, read_percent, keys,
+                [&](int k) {
+                    return c.contains(k);
+                },
+                [&](int k, bool insert) {
+                    if (insert)
+                    {
+                        c.insert({k, k});
+                    }
+                    else
+                    {
+                        c.erase(k);
+                    }
+                });
+
+            // threads, share of lookups, operations per second of both trees
+            outFile << threads << "\t" << read_percent << "\t" << locked << "\t" << lock_free << "\n";
+        }
+    }
+    outFile.close();
+}
 
-    const int N{10000}; // Number of elements to be inserted and found 
+// Average time per lookup, in nanoseconds, of a loop of finds and of
+// find_batch (with and without sorting the keys), on a tree too big for
+// the cache, for keys spread over the whole tree and for keys that fall
+// in a few narrow clusters
+void batch_benchmark()
+{
+    const int keys{1 << 20};
+    const int lookups{1 << 18};
 
     std::ofstream outFile;
-    outFile.open("../benchmark/benchmark_times.txt");
-
-    //For generating random numbers
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    std::uniform_int_distribution<std::mt19937::result_type> dist(1,100000); 
-
-    std::vector<int> numbers;
-    for(int j = 0; j <= N; ++j){
-      numbers.push_back(dist(rng));
-    }
-
-    bst<int,std::string> b;   // unbalanced tree
-    bst<int,std::string> balb; // balanced tree
-    std::map<int,std::string> m; // maps
-
-
-for (size_t i = 100; i <= N; i+=10)
-{
-    for(size_t k = 0; k < i; ++k){
-        //std::cout << dist(rng) << std::endl;
-        b.insert({numbers[k],std::to_string(numbers[k])});
-        balb.insert({numbers[k],std::to_string(numbers[k])});
-        m.insert({numbers[k],std::to_string(numbers[k])});
-    }  
-
-    //measuring time to find keys with std::map
-  	auto t0_map = std::chrono::steady_clock::now();
-   	for(size_t k = 0 ; k < i; ++k){
- 		  m.find(numbers[k]);
-  	}
-	  auto t1_map = std::chrono::steady_clock::now();
-	  auto elapsed_map = std::chrono::duration_cast<std::chrono::microseconds>(t1_map-t0_map);  
-
-    
-    //measuring time to find keys with unbalanced bst
-  	auto t0_bst = std::chrono::steady_clock::now();
-   	for(size_t k = 0; k < i; ++k){
- 		  b.find(numbers[k]);
-  	}
-	  auto t1_bst = std::chrono::steady_clock::now();
-	  auto elapsed_bst = std::chrono::duration_cast<std::chrono::microseconds>(t1_bst-t0_bst);
-
-    //measuring time to find keys with balanced bst
-        balb.balance();
-  	auto t0_bst_bal = std::chrono::steady_clock::now();
-   	for(size_t k{0}; k < i; ++k){
- 		  balb.find(numbers[k]);
-  	}
-	  auto t1_bst_bal = std::chrono::steady_clock::now();
-	  auto elapsed_bst_bal = std::chrono::duration_cast<std::chrono::microseconds>(t1_bst_bal-t0_bst_bal);
-
-    // write results to file
-    outFile << i << "\t" << (double(elapsed_map.count()))/((double)N) << "\t" << (double(elapsed_bst.count()))/((double)N) << "\t" << (double(elapsed_bst_bal.count()))/((double)N) << "\n";
+    outFile.open("../benchmark/benchmark_batch.txt");
+
+    // keys inserted in random order, so that nodes close in the tree
+    // are not close in memory
+    std::mt19937 rng(42);
+    std::vector<int> order(keys);
+    for (int k = 0; k < keys; ++k)
+    {
+        order[k] = 2 * k;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    bst<int,int,std::less<int>,avl_balance> b;
+    for (int k : order)
+    {
+        b.insert({k, k});
+    }
+
+    // random keys, half of them missing, and keys taken from 16 windows
+    std::vector<int> random_keys(lookups), clustered_keys(lookups);
+    std::uniform_int_distribution<int> any(0, 2 * keys - 1), offset(0, 2047);
+    for (int &k : random_keys)
+    {
+        k = any(rng);
+    }
+    std::vector<int> windows(16);
+    for (int &w : windows)
+    {
+        w = any(rng);
+    }
+    for (int i = 0; i < lookups; ++i)
+    {
+        clustered_keys[i] = windows[i % windows.size()] + offset(rng);
+    }
+
+    std::vector<decltype(b.begin())> results(lookups);
+    for (const auto *set : {&random_keys, &clustered_keys})
+    {
+        auto t0_loop = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; ++i)
+        {
+            results[i] = b.find((*set)[i]);
+        }
+        auto t1_loop = std::chrono::steady_clock::now();
+
+        auto t0_batch = std::chrono::steady_clock::now();
+        b.find_batch(set->begin(), set->end(), results.begin());
+        auto t1_batch = std::chrono::steady_clock::now();
+
+        auto t0_sorted = std::chrono::steady_clock::now();
+        b.find_batch(set->begin(), set->end(), results.begin(), true);
+        auto t1_sorted = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::nano> loop = t1_loop - t0_loop, batch = t1_batch - t0_batch,
+                                                 sorted = t1_sorted - t0_sorted;
+        // key set (0 random, 1 clustered), nanoseconds per lookup of the three methods
+        outFile << (set == &clustered_keys) << "\t" << loop.count() / lookups << "\t"
+                << batch.count() / lookups << "\t" << sorted.count() / lookups << "\n";
+    }
+    outFile.close();
+}
+
+
+
+// Settings of the single-threaded harness, given on the command line
+struct options
+{
+    std::vector<std::size_t> sizes{1 << 10, 1 << 14, 1 << 17};
+    std::uint64_t seed{42};
+    bool counters{false};
+    // path of the output files, without the extension
+    std::string out{"../benchmark/benchmark_results"};
+};
+
+// Operations run between two readings of the hardware counters: reading
+// them takes a system call, too slow to be done around every operation
+const std::size_t ops_per_sample{16};
+// Samples taken of the operations on the whole tree (copy and balance)
+const std::size_t whole_tree_samples{15};
+// Without a balancing policy sorted and reverse keys turn the tree into a
+// list and every operation takes linear time: larger sizes are skipped
+const std::size_t max_degenerate_size{1 << 14};
+
+// Keeps the results of the timed operations alive
+volatile std::size_t sink;
+
+// Cache and branch misses of the calling thread, read with perf_event_open.
+// They are available only on Linux and only if the kernel allows it (see
+// /proc/sys/kernel/perf_event_paranoid), otherwise nothing is counted.
+class hw_counters
+{
+    private:
+        int fds[2]{-1, -1};
+
+        void close_all()
+        {
+#if defined(__linux__)
+            for (int &fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+                fd = -1;
+            }
+#endif
+        }
+
+    public:
+        // misses counted since the last reset
+        double cache_misses{0}, branch_misses{0};
+
+        explicit hw_counters(bool enabled)
+        {
+#if defined(__linux__)
+            if (enabled)
+            {
+                const std::uint64_t events[2]{PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+                for (int e = 0; e < 2; ++e)
+                {
+                    perf_event_attr attr{};
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.size = sizeof(attr);
+                    attr.config = events[e];
+                    attr.disabled = 1;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+                }
+                if (!available())
+                {
+                    close_all();
+                }
+            }
+#else
+            (void)enabled;
+#endif
+        }
+
+        hw_counters(const hw_counters&) = delete;
+        hw_counters& operator=(const hw_counters&) = delete;
+
+        ~hw_counters()
+        {
+            close_all();
+        }
+
+        bool available() const { return fds[0] >= 0 && fds[1] >= 0; }
+
+        void reset() { cache_misses = branch_misses = 0; }
+
+        void start()
+        {
+#if defined(__linux__)
+            if (available())
+            {
+                for (int fd : fds)
+                {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+#endif
+        }
+
+        void stop()
+        {
+#if defined(__linux__)
+            if (available())
+            {
+                std::uint64_t values[2]{0, 0};
+                for (int e = 0; e < 2; ++e)
+                {
+                    ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+                    if (read(fds[e], &values[e], sizeof(values[e])) != sizeof(values[e]))
+                    {
+                        values[e] = 0;
+                    }
+                }
+                cache_misses += values[0];
+                branch_misses += values[1];
+            }
+#endif
+        }
+};
+
+// Timings of one operation on one tree
+struct measurement
+{
+    std::string tree, input, operation;
+    std::size_t size, ops;
+    double median_ns, p99_ns, ops_per_sec;
+    // misses per operation, negative if they were not counted
+    double cache_misses, branch_misses;
+    // height of the tree once all the keys are inserted, negative if the
+    // tree does not expose it
+    int height;
+};
+
+// Time, in nanoseconds, between two consecutive readings of the clock:
+// the median over many pairs, computed once
+double clock_overhead()
+{
+    static const double overhead = []() {
+        std::vector<double> pairs(10001);
+        for (double &pair : pairs)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            auto t1 = std::chrono::steady_clock::now();
+            pair = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        }
+        std::nth_element(pairs.begin(), pairs.begin() + pairs.size() / 2, pairs.end());
+        return pairs[pairs.size() / 2];
+    }();
+    return overhead;
+}
+
+// Times ops operations in groups of per_sample, reading the hardware
+// counters around each group. prepare(i) runs, untimed, before the group
+// starting with operation i, and op(i) performs operation i. Groups take
+// turns: in one the operations are timed one by one, and the latency of
+// each is the time between the clock readings around it minus the cost of
+// reading the clock, which gives the median and the p99 of single
+// operations; the next one is timed as a whole, with no clock reading in
+// between, and ops/sec is computed from the wall-clock time of these.
+// A group of a single operation is used for both.
+template<class Prepare, class Op>
+measurement measure(std::size_t ops, std::size_t per_sample, hw_counters& hw, Prepare prepare, Op op)
+{
+    const double overhead = clock_overhead();
+    std::vector<double> samples;
+    samples.reserve(ops);
+    // wall-clock time and number of the operations timed in groups
+    double wall{0};
+    std::size_t wall_ops{0};
+    hw.reset();
+
+    for (std::size_t i = 0, group = 0; i < ops; i += per_sample, ++group)
+    {
+        std::size_t last = std::min(i + per_sample, ops);
+        prepare(i);
+        hw.start();
+        if (per_sample > 1 && group % 2)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            for (std::size_t j = i; j < last; ++j)
+            {
+                op(j);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+
+            wall += std::chrono::duration<double, std::nano>(t1 - t0).count();
+            wall_ops += last - i;
+        }
+        else
+        {
+            for (std::size_t j = i; j < last; ++j)
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                op(j);
+                auto t1 = std::chrono::steady_clock::now();
+
+                std::chrono::duration<double, std::nano> elapsed = t1 - t0;
+                samples.push_back(std::max(elapsed.count() - overhead, 0.0));
+                if (per_sample == 1)
+                {
+                    wall += elapsed.count();
+                    ++wall_ops;
+                }
+            }
+        }
+        hw.stop();
+    }
+
+    measurement m{};
+    m.ops = ops;
+    m.cache_misses = m.branch_misses = -1;
+    m.height = -1;
+    if (!samples.empty())
+    {
+        std::sort(samples.begin(), samples.end());
+        m.median_ns = samples[samples.size() / 2];
+        m.p99_ns = samples[(samples.size() * 99 + 99) / 100 - 1];
+        m.ops_per_sec = wall > 0 ? wall_ops / wall * 1e9 : 0;
+        if (hw.available())
+        {
+            m.cache_misses = hw.cache_misses / ops;
+            m.branch_misses = hw.branch_misses / ops;
+        }
+    }
+    return m;
+}
+
+// Sequence of n keys in the given input order. Only even keys are
+// generated, so odd keys can be used for unsuccessful lookups.
+std::vector<int> make_keys(const std::string& input, std::size_t n, std::uint64_t seed)
+{
+    std::vector<int> keys(n);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+        keys[k] = 2 * k;
+    }
+
+    std::mt19937_64 rng(seed);
+    if (input == "reverse")
+    {
+        std::reverse(keys.begin(), keys.end());
+    }
+    else if (input == "random")
+    {
+        std::shuffle(keys.begin(), keys.end(), rng);
+    }
+    else if (input == "zipf")
+    {
+        // n draws of the key of rank r with probability proportional to
+        // 1 / r^0.99: the keys are shuffled first so that the popular ones
+        // are scattered over the tree
+        std::shuffle(keys.begin(), keys.end(), rng);
+        std::vector<double> cdf(n);
+        double sum{0};
+        for (std::size_t r = 0; r < n; ++r)
+        {
+            sum += 1 / std::pow(r + 1, 0.99);
+            cdf[r] = sum;
+        }
+
+        std::uniform_real_distribution<double> u(0, sum);
+        std::vector<int> draws(n);
+        for (int &key : draws)
+        {
+            std::size_t r = std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin();
+            key = keys[std::min(r, n - 1)];
+        }
+        return draws;
+    }
+    return keys;
+}
+
+template<class Tree>
+struct is_bst : std::false_type {};
+
+template<class K, class V, class C, class P, template<class> class A>
+struct is_bst<bst<K, V, C, P, A>> : std::true_type {};
+
+const auto untimed = [](std::size_t) {};
+
+// Returns a function that completes a measurement with the tree, the input
+// and the operation, and appends it to results
+auto recorder(const std::string& tree, const std::string& input, std::size_t n, const int& height,
+              std::vector<measurement>& results)
+{
+    return [&tree, &input, n, &height, &results](const std::string& operation, measurement m) {
+        m.tree = tree;
+        m.input = input;
+        m.operation = operation;
+        m.size = n;
+        m.height = height;
+        results.push_back(m);
+    };
+}
+
+// Times the lookups and the in-order visit of a tree holding keys
+template<class Tree, class Record>
+void run_lookups(const Tree& t, const std::vector<int>& keys, hw_counters& hw, Record record)
+{
+    std::size_t hits{0};
+    record("find_hit", measure(keys.size(), ops_per_sample, hw, untimed, [&](std::size_t i) {
+        hits += t.find(keys[i]) != t.end();
+    }));
+    record("find_miss", measure(keys.size(), ops_per_sample, hw, untimed, [&](std::size_t i) {
+        hits += t.find(keys[i] + 1) != t.end();
+    }));
+
+    std::size_t elements = std::distance(t.begin(), t.end());
+    auto it = t.begin();
+    record("iterate", measure(elements, ops_per_sample, hw, untimed, [&](std::size_t) {
+        hits += it->second;
+        ++it;
+    }));
+    sink = hits;
+}
+
+// Times every operation on a tree of type Tree, filled by inserting keys
+// in order
+template<class Tree>
+void run_tree(const std::string& tree, const std::string& input, const std::vector<int>& keys,
+              hw_counters& hw, std::vector<measurement>& results)
+{
+    const std::size_t n = keys.size();
+    int height{-1};
+    auto record = recorder(tree, input, n, height, results);
+
+    Tree t;
+    measurement inserted = measure(n, ops_per_sample, hw, untimed, [&](std::size_t i) {
+        t.insert({keys[i], int(i)});
+    });
+    if constexpr (is_bst<Tree>::value)
+    {
+        height = t.height(t.getRoot());
+    }
+    record("insert", inserted);
+    run_lookups(t, keys, hw, record);
+
+    // the copies are destroyed out of the timed part
+    std::optional<Tree> copy;
+    record("copy", measure(whole_tree_samples, 1, hw, [&](std::size_t) { copy.reset(); }, [&](std::size_t) {
+        copy.emplace(t);
+    }));
+    if constexpr (is_bst<Tree>::value)
+    {
+        record("balance", measure(whole_tree_samples, 1, hw, [&](std::size_t) {
+            copy.reset();
+            copy.emplace(t);
+        }, [&](std::size_t) {
+            copy->balance();
+        }));
+    }
+    copy.reset();
+
+    record("erase", measure(n, ops_per_sample, hw, untimed, [&](std::size_t i) {
+        t.erase(keys[i]);
+    }));
+
+    Tree counts;
+    record("operator[]", measure(n, ops_per_sample, hw, untimed, [&](std::size_t i) {
+        ++counts[keys[i]];
+    }));
+}
+
+// Times freeze() of an AVL tree filled by inserting keys in order, and the
+// lookups and the visit of the frozen_bst it returns
+void run_frozen(const std::string& input, const std::vector<int>& keys, hw_counters& hw,
+                std::vector<measurement>& results)
+{
+    const std::string tree{"frozen_bst"};
+    const int height{-1};
+    auto record = recorder(tree, input, keys.size(), height, results);
+
+    bst<int,int,std::less<int>,avl_balance> t;
+    for (std::size_t i = 0; i < keys.size(); ++i)
+    {
+        t.insert({keys[i], int(i)});
+    }
+
+    // the snapshots are destroyed out of the timed part
+    std::optional<frozen_bst<int,int>> frozen;
+    record("freeze", measure(whole_tree_samples, 1, hw, [&](std::size_t) { frozen.reset(); }, [&](std::size_t) {
+        frozen.emplace(t.freeze());
+    }));
+    run_lookups(*frozen, keys, hw, record);
+}
+
+// Writes a number of misses (or a height), leaving the field empty if they
+// were not counted
+void write_misses(std::ostream& os, double misses, const char* missing)
+{
+    if (misses < 0)
+    {
+        os << missing;
+    }
+    else
+    {
+        os << misses;
+    }
+}
+
+void write_csv(const std::string& path, const std::vector<measurement>& results)
+{
+    std::ofstream outFile{path};
+    outFile << "tree,input,operation,size,ops,median_ns,p99_ns,ops_per_sec,cache_misses_per_op,branch_misses_per_op,height\n";
+    for (const auto &m : results)
+    {
+        outFile << m.tree << "," << m.input << "," << m.operation << "," << m.size << "," << m.ops << ","
+                << m.median_ns << "," << m.p99_ns << "," << m.ops_per_sec << ",";
+        write_misses(outFile, m.cache_misses, "");
+        outFile << ",";
+        write_misses(outFile, m.branch_misses, "");
+        outFile << ",";
+        write_misses(outFile, m.height, "");
+        outFile << "\n";
+    }
+}
+
+void write_json(const std::string& path, const std::vector<measurement>& results)
+{
+    std::ofstream outFile{path};
+    outFile << "[\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto &m = results[i];
+        outFile << "  {\"tree\": \"" << m.tree << "\", \"input\": \"" << m.input
+                << "\", \"operation\": \"" << m.operation << "\", \"size\": " << m.size
+                << ", \"ops\": " << m.ops << ", \"median_ns\": " << m.median_ns
+                << ", \"p99_ns\": " << m.p99_ns << ", \"ops_per_sec\": " << m.ops_per_sec
+                << ", \"cache_misses_per_op\": ";
+        write_misses(outFile, m.cache_misses, "null");
+        outFile << ", \"branch_misses_per_op\": ";
+        write_misses(outFile, m.branch_misses, "null");
+        outFile << ", \"height\": ";
+        write_misses(outFile, m.height, "null");
+        outFile << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    outFile << "]\n";
 }
-	  outFile.close();
-	  return 0; 
 
-}
\ No newline at end of file
+// Runs every operation on std::map, on the bst without balancing and on the
+// AVL one, and the lookups on the frozen_bst, for every size and input
+// order, and writes the results as CSV and JSON
+void harness(const options& opt)
+{
+    hw_counters hw{opt.counters};
+    if (opt.counters && !hw.available())
+    {
+        std::cerr << "Hardware counters are not available, they will not be reported" << std::endl;
+    }
+
+    std::vector<measurement> results;
+    for (std::size_t n : opt.sizes)
+    {
+        for (const std::string input : {"random", "sorted", "reverse", "zipf"})
+        {
+            std::vector<int> keys = make_keys(input, n, opt.seed);
+            run_tree<std::map<int,int>>("std::map", input, keys, hw, results);
+            if ((input != "sorted" && input != "reverse") || n <= max_degenerate_size)
+            {
+                run_tree<bst<int,int>>("bst<no_balance>", input, keys, hw, results);
+            }
+            run_tree<bst<int,int,std::less<int>,avl_balance>>("bst<avl_balance>", input, keys, hw, results);
+            run_frozen(input, keys, hw, results);
+        }
+    }
+
+    std::cout << std::left << std::setw(18) << "tree" << std::setw(9) << "input" << std::setw(12) << "operation"
+              << std::right << std::setw(8) << "size" << std::setw(14) << "median (ns)"
+              << std::setw(12) << "p99 (ns)" << std::setw(14) << "ops/sec" << std::setw(8) << "height" << "\n";
+    for (const auto &m : results)
+    {
+        std::cout << std::left << std::setw(18) << m.tree << std::setw(9) << m.input << std::setw(12) << m.operation
+                  << std::right << std::setw(8) << m.size << std::setw(14) << m.median_ns
+                  << std::setw(12) << m.p99_ns << std::setw(14) << m.ops_per_sec << std::setw(8);
+        write_misses(std::cout, m.height, "");
+        std::cout << "\n";
+    }
+
+    write_csv(opt.out + ".csv", results);
+    write_json(opt.out + ".json", results);
+}
+
+
+int main(int argc, char *argv[]) {
+
+    options opt;
+    for (int a = 1; a < argc; ++a)
+    {
+        std::string arg{argv[a]};
+        // multi-threaded mode: ./benchmark.o threads
+        if (arg == "threads")
+        {
+            thread_benchmark();
+            return 0;
+        }
+        // batched lookups: ./benchmark.o batch
+        else if (arg == "batch")
+        {
+            batch_benchmark();
+            return 0;
+        }
+        else if (arg == "--counters")
+        {
+            opt.counters = true;
+        }
+        else if (arg == "--seed" && a + 1 < argc)
+        {
+            opt.seed = std::stoull(argv[++a]);
+        }
+        else if (arg == "--sizes" && a + 1 < argc)
+        {
+            // comma-separated list of sizes
+            opt.sizes.clear();
+            std::string list{argv[++a]};
+            for (std::size_t start = 0; start < list.size(); )
+            {
+                std::size_t comma = std::min(list.find(',', start), list.size());
+                opt.sizes.push_back(std::stoull(list.substr(start, comma - start)));
+                start = comma + 1;
+            }
+        }
+        else if (arg == "--out" && a + 1 < argc)
+        {
+            opt.out = argv[++a];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [threads | batch | [--sizes n1,n2,...] [--seed s] [--counters] [--out path]]" << std::endl;
+            return 1;
+        }
+    }
+
+    harness(opt);
+    return 0;
+}
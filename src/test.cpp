@@ -1,5 +1,45 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+#include <new>
+#include <cstdlib>
+#include <atomic>
 #include "bst.hxx"
+#include "concurrent.hxx"
+
+// number of slabs of pool_allocator currently allocated, counted by
+// replacing the aligned operator new and delete it gets them from
+std::atomic<std::size_t> live_slabs{0};
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    std::size_t align = static_cast<std::size_t>(alignment);
+    void *ptr = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!ptr)
+    {
+        throw std::bad_alloc{};
+    }
+    ++live_slabs;
+    return ptr;
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    if (ptr)
+    {
+        --live_slabs;
+        std::free(ptr);
+    }
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
 
 int main() {
     bst<int, int> tree1{};
@@ -170,5 +210,299 @@ int main() {
     b.clear();
     std::cout << "\nAfter clear" <<  b << std::endl;
     std::cout << b << std::endl;
-    
+
+    // Testing the AVL policy: keys inserted in order must not degenerate
+    bst<int, int, std::less<int>, avl_balance> avl{};
+    for (int i = 0; i < 1000; i++)
+    {
+        avl.insert(std::pair<const int, int>(i, i));
+    }
+    std::cout << "\nAVL tree with 1000 sorted keys is balanced?\n"
+              << (avl.isBalanced(avl.getRoot()) ? "Yes\n" : "No\n");
+    std::cout << "Height of tree: " << avl.height(avl.getRoot()) << std::endl;
+
+    for (int i = 0; i < 1000; i += 2)
+    {
+        avl.erase(i);
+    }
+    avl[2000] = 2000;
+    avl.emplace(3000, 3000);
+    std::cout << "After erasing the even keys, is it balanced?\n"
+              << (avl.isBalanced(avl.getRoot()) ? "Yes\n" : "No\n");
+    std::cout << "Height of tree: " << avl.height(avl.getRoot()) << std::endl;
+
+    // Testing the node allocators: a degenerate tree is destroyed without
+    // recursion, both with the pool and with plain heap allocations
+    bst<int, std::string> pooled{};
+    bst<int, std::string, std::less<int>, no_balance, heap_allocator> heap{};
+    for (int i = 0; i < 10000; i++)
+    {
+        pooled.emplace(i, std::to_string(i));
+        heap.emplace(i, std::to_string(i));
+    }
+    std::cout << "\nHeight of the degenerate trees: " << pooled.height(pooled.getRoot())
+              << " " << heap.height(heap.getRoot()) << std::endl;
+    pooled.erase(5000);
+    heap.erase(5000);
+    pooled.clear();
+    heap.clear();
+    std::cout << "After clear: " << pooled << heap << std::endl;
+    pooled.emplace(1, "one");
+    std::cout << "Pool reused after clear: " << pooled << std::endl;
+
+    // Testing the construction from a sorted range
+    std::vector<std::pair<int, int>> sorted;
+    for (int i = 0; i < 15; i++)
+    {
+        sorted.emplace_back(i, i * i);
+    }
+    bst<int, int> from_range{sorted.begin(), sorted.end()};
+    std::cout << "\nTree built from a sorted range:\n" << from_range << std::endl;
+    std::cout << "Is it balanced? " << (from_range.isBalanced(from_range.getRoot()) ? "Yes" : "No")
+              << ", height: " << from_range.height(from_range.getRoot()) << std::endl;
+    from_range.assign(sorted.begin(), sorted.begin() + 7);
+    std::cout << "After assigning the first 7 pairs:\n" << from_range << std::endl;
+
+    // Testing balance() and copy on a degenerate tree
+    bst<int, int> vine{};
+    for (int i = 0; i < 1000; i++)
+    {
+        vine.insert(std::pair<const int, int>(i, i));
+    }
+    bst<int, int> vine_copy{vine};
+    vine.balance();
+    std::cout << "Height of the copy: " << vine_copy.height(vine_copy.getRoot())
+              << ", after balancing the original: " << vine.height(vine.getRoot()) << std::endl;
+
+    // Testing the frozen snapshot
+    auto frozen = from_range.freeze();
+    from_range.erase(3);
+    std::cout << "\nFrozen snapshot (taken before erasing 3):\n" << frozen << std::endl;
+    auto found = frozen.find(3);
+    std::cout << "Value of key 3 in the snapshot: " << found->second << std::endl;
+    if (frozen.find(42) == frozen.end())
+    {
+        std::cout << "Key 42 is not in the snapshot" << std::endl;
+    }
+    int frozen_sum = 0;
+    for (auto &pair : frozen)
+    {
+        frozen_sum += pair.second;
+    }
+    // iterators are multi-pass: max_element keeps copies of them
+    auto largest = std::max_element(frozen.begin(), frozen.end(), [](const auto &a, const auto &b) {
+        return a.second < b.second;
+    });
+    std::cout << "Sum of the values in the snapshot: " << frozen_sum
+              << ", largest: (" << largest->first << ", " << largest->second << ")" << std::endl;
+
+    // Testing range queries and reverse iteration
+    bst<int, int, std::less<int>, order_statistics<avl_balance>> stats{};
+    for (int i = 0; i < 20; i += 2)
+    {
+        stats.emplace(i, i);
+    }
+    std::cout << "\nTree: " << stats << std::endl;
+    std::cout << "lower_bound(5): " << stats.lower_bound(5)->first
+              << ", upper_bound(6): " << stats.upper_bound(6)->first << std::endl;
+    auto range = stats.equal_range(8);
+    std::cout << "equal_range(8): [" << range.first->first << ", " << range.second->first << ")" << std::endl;
+    std::cout << "Keys in [5, 13): ";
+    for (auto it = stats.lower_bound(5); it != stats.lower_bound(13); ++it)
+    {
+        std::cout << it->first << " ";
+    }
+    std::cout << "\nReverse order: ";
+    for (auto rit = stats.rbegin(); rit != stats.rend(); ++rit)
+    {
+        std::cout << rit->first << " ";
+    }
+    auto last = stats.end();
+    --last;
+    std::cout << "\nLast key: " << last->first << std::endl;
+
+    // Testing rank, select, count_range and size
+    std::cout << "size: " << stats.size() << ", rank(7): " << stats.rank(7)
+              << ", select(3): " << stats.select(3)->first
+              << ", count_range(3, 11): " << stats.count_range(3, 11) << std::endl;
+    stats.erase(6);
+    std::cout << "After erasing 6, size: " << stats.size() << ", rank(7): " << stats.rank(7)
+              << ", select(3): " << stats.select(3)->first << std::endl;
+
+    // Testing batched lookups: the results are given in the order of the keys
+    std::vector<int> wanted{14, 7, 2, 18, 6, 0};
+    std::vector<bool> present(wanted.size());
+    stats.contains_batch(wanted.begin(), wanted.end(), present.begin());
+    std::cout << "contains_batch(14, 7, 2, 18, 6, 0): ";
+    for (bool p : present)
+    {
+        std::cout << (p ? "Yes " : "No ");
+    }
+    std::vector<decltype(stats.begin())> hits(wanted.size());
+    stats.find_batch(wanted.begin(), wanted.end(), hits.begin(), true);
+    std::cout << "\nfind_batch (sorted) values: ";
+    for (auto hit : hits)
+    {
+        if (hit != stats.end())
+        {
+            std::cout << hit->second << " ";
+        }
+    }
+    std::cout << std::endl;
+
+    // Testing save and load: the loaded tree is perfectly balanced, and a
+    // tree of raw keys and values can be mapped in memory without loading it
+    stats.save("test_tree.bin");
+    bst<int, int> loaded{};
+    loaded.load("test_tree.bin");
+    std::cout << "\nLoaded tree: " << loaded << std::endl;
+    std::cout << "Is balanced? " << (loaded.isBalanced(loaded.getRoot()) ? "Yes" : "No") << std::endl;
+    mapped_bst<int, int> mapped{"test_tree.bin"};
+    std::cout << "Mapped tree: " << mapped << ", value of key 12: " << mapped.find(12)->second
+              << ", key 6 found? " << (mapped.find(6) != mapped.end() ? "Yes" : "No") << std::endl;
+    bst<int, std::string> names{};
+    names.insert({2, "two"});
+    names.insert({1, "one"});
+    names.save("test_names.bin");
+    bst<int, std::string> names_loaded{};
+    names_loaded.load("test_names.bin");
+    std::cout << "Loaded strings: " << names_loaded << std::endl;
+    try
+    {
+        bst<long, double> wrong{};
+        wrong.load("test_names.bin");
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "Loading with other types: " << e.what() << std::endl;
+    }
+    {
+        // corrupt the length of the first string, which follows the
+        // header and the first key
+        std::fstream corrupt{"test_names.bin", std::ios::in | std::ios::out | std::ios::binary};
+        corrupt.seekp(sizeof(save_header) + sizeof(int));
+        serializer<std::uint64_t>::write(corrupt, std::uint64_t{1} << 40);
+    }
+    try
+    {
+        names_loaded.load("test_names.bin");
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "Loading a corrupted file: " << e.what() << ", tree empty? "
+                  << (names_loaded.begin() == names_loaded.end() ? "Yes" : "No") << std::endl;
+    }
+    std::remove("test_tree.bin");
+    std::remove("test_names.bin");
+
+    // Testing try_emplace, insert_or_assign and hinted insertion: appending
+    // with end() as hint does not search the tree
+    bst<int, std::string, std::less<int>, avl_balance> words{};
+    for (int i = 0; i < 8; i++)
+    {
+        words.insert(words.end(), {i, std::to_string(i)});
+    }
+    std::string moved = "new";
+    auto tried = words.try_emplace(3, std::move(moved));
+    std::cout << "\ntry_emplace on key 3 inserted? " << (tried.second ? "Yes" : "No")
+              << ", value " << tried.first->second << ", argument kept: " << moved << std::endl;
+    words.insert_or_assign(3, "three");
+    words.insert_or_assign(10, "ten");
+    words.insert(words.find(10), {9, "nine"});
+    std::cout << "After insert_or_assign and hinted insert: " << words << std::endl;
+    std::cout << "Is balanced? " << (words.isBalanced(words.getRoot()) ? "Yes" : "No") << std::endl;
+
+    // Testing lookups with a transparent comparator: no std::string is built
+    bst<std::string, int, std::less<>> fruits{};
+    fruits.insert({"apple", 1});
+    fruits.insert({"pear", 2});
+    std::string_view fruit = "pear";
+    std::cout << "Value of pear: " << fruits.find(fruit)->second
+              << ", first key not less than banana: " << fruits.lower_bound("banana")->first << std::endl;
+
+    // Testing node handles and merge
+    const std::string *three = &words.find(3)->second;
+    auto handle = words.extract(3);
+    handle.mapped() = "THREE";
+    auto reinserted = words.insert(std::move(handle));
+    std::cout << "Extracted and reinserted key 3: " << reinserted.position->second
+              << ", handle empty? " << (handle.empty() ? "Yes" : "No")
+              << ", same node? " << (&reinserted.position->second == three ? "Yes" : "No") << std::endl;
+    bst<int, std::string, std::less<int>, avl_balance> others{};
+    others.insert({3, "drei"});
+    others.insert({20, "zwanzig"});
+    words.merge(others);
+    std::cout << "After merge: " << words << std::endl;
+    std::cout << "Left in the source: " << others << std::endl;
+
+    // without a pool, nodes move between trees as they are
+    bst<int, std::string, std::less<int>, avl_balance, heap_allocator> from_heap{}, to_heap{};
+    from_heap.insert({1, "one"});
+    from_heap.insert({2, "two"});
+    const std::string *one = &from_heap.find(1)->second;
+    to_heap.merge(from_heap);
+    to_heap.insert(from_heap.extract(2));
+    std::cout << "Merged between heap trees: " << to_heap << ", same node? "
+              << (&to_heap.find(1)->second == one ? "Yes" : "No") << std::endl;
+
+    // a handle keeps the memory of its node after the tree it comes from is gone
+    decltype(words)::node_type orphan;
+    {
+        bst<int, std::string, std::less<int>, avl_balance> scoped{};
+        scoped.insert({30, "dreissig"});
+        orphan = scoped.extract(30);
+    }
+    std::cout << "Handle outliving its tree: (" << orphan.key() << ", " << orphan.mapped() << ")";
+    words.insert(std::move(orphan));
+    std::cout << ", inserted: " << words.find(30)->second << std::endl;
+
+    // moving nodes out of a pool tree does not keep its slabs alive once
+    // the tree is gone
+    bst<int, int, std::less<int>, avl_balance> keeper{};
+    std::size_t slabs_before = live_slabs;
+    for (int round = 0; round < 50; round++)
+    {
+        bst<int, int, std::less<int>, avl_balance> temporary{};
+        for (int i = 0; i < 20000; i++)
+        {
+            temporary.insert({i, i});
+        }
+        keeper.insert(temporary.extract(round));
+        bst<int, int, std::less<int>, avl_balance> merged{};
+        merged.insert({1000 + round, round});
+        keeper.merge(merged);
+    }
+    std::cout << "Nodes moved to the long-lived tree: " << keeper.size()
+              << ", slabs still allocated: " << live_slabs - slabs_before << std::endl;
+
+    // Testing the concurrent tree: writers insert disjoint ranges of keys
+    // while readers look them up
+    concurrent_bst<int, int> shared{};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++)
+    {
+        workers.emplace_back([&shared, t]() {
+            for (int i = t * 250; i < (t + 1) * 250; i++)
+            {
+                shared.insert(std::pair<const int, int>(i, i));
+                shared.contains(i / 2);
+            }
+        });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    shared.erase(500);
+    std::cout << "\nConcurrent tree size: " << shared.size() << std::endl;
+    std::cout << "Value of key 42: " << shared.find(42).value_or(-1)
+              << ", key 500 found? " << (shared.contains(500) ? "Yes" : "No") << std::endl;
+    int previous = -1;
+    bool sorted_keys = true;
+    for (auto &node : shared.view())
+    {
+        sorted_keys = sorted_keys && node.first > previous;
+        previous = node.first;
+    }
+    std::cout << "Keys visited in order? " << (sorted_keys ? "Yes" : "No") << std::endl;
 }
\ No newline at end of file